@@ -1,23 +1,81 @@
-#include <math.h>
 #include <stdio.h>
 #include "pico/stdlib.h"
 #include "Adafruit_BME280.h"
 
+#if BME280_FLOAT_API
+#include <math.h>
+#endif
+
+#if BME280_CALIB_CACHE
+#include <string.h>
+#include "hardware/flash.h"
+#include "pico/flash.h"
+
+#define BME280_CALIB_CACHE_MAGIC 0x42453238
+#define BME280_CALIB_CACHE_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define BME280_CALIB_CACHE_SLOTS 4
+
+typedef struct
+{
+  uint32_t magic;
+  uint8_t chip_id;
+  uint8_t address;
+  uint8_t calib[BME280_CALIB_BLOCK1_LEN + BME280_CALIB_BLOCK2_LEN];
+} bme280_calib_cache_entry;
+
+static bool loadCachedCoefficients(bme280_t *dev, uint8_t chip_id, uint8_t *calib);
+static void storeCachedCoefficients(bme280_t *dev, uint8_t chip_id, const uint8_t *calib);
+#endif
+
+static void readN(bme280_t *dev, uint8_t reg, uint8_t *buffer, uint8_t len);
 static uint8_t read8(bme280_t *dev, uint8_t reg);
 static uint16_t read16(bme280_t *dev, uint8_t reg);
 static uint32_t read24(bme280_t *dev, uint8_t reg);
 static int16_t readS16(bme280_t *dev, uint8_t reg);
-static uint16_t read16_LE(bme280_t *dev, uint8_t reg);
-static int16_t readS16_LE(bme280_t *dev, uint8_t reg);
 static void write8(bme280_t *dev, uint8_t reg, uint8_t value);
-static void readCoefficients(bme280_t *dev);
+static void readCoefficients(bme280_t *dev, uint8_t chip_id);
+static void unpackCoefficients(bme280_t *dev, const uint8_t *calib);
 static bool isReadingCalibration(bme280_t *dev);
+static uint8_t oversamplingCount(sensor_sampling sampling);
+static int64_t forcedMeasurementAlarm(alarm_id_t id, void *user_data);
+static void forcedReadDone(bool success, void *user_data);
+static void completeForcedMeasurement(bme280_t *dev, const uint8_t *raw);
+static int32_t compensate_temperature(bme280_t *dev, int32_t adc_T);
+static uint32_t compensate_pressure(bme280_t *dev, int32_t adc_P);
+static uint32_t compensate_humidity(bme280_t *dev, int32_t adc_H);
+
+// Altitude in cm for pressure / sea level pressure ratios from 0.25 to 1.125 in steps of 1/128,
+// linear interpolation stays within 0.66 m of the barometric formula down to 0.25 (about 10 km)
+// and within 0.09 m below 1000 m
+#define ALTITUDE_TABLE_RATIO_MIN (1 << 18) // 0.25 in Q20
+#define ALTITUDE_TABLE_STEP (1 << 13)      // 1/128 in Q20
+#define ALTITUDE_TABLE_LEN 113
+
+static const int32_t altitude_table[ALTITUDE_TABLE_LEN] = {
+    1027933, 1007935, 988421, 969367, 950749, 932545, 914735, 897301,
+    880225, 863491, 847085, 830992, 815199, 799694, 784465, 769503,
+    754795, 740334, 726110, 712115, 698340, 684777, 671421, 658263,
+    645298, 632518, 619919, 607495, 595240, 583149, 571217, 559441,
+    547815, 536335, 524997, 513797, 502732, 491798, 480992, 470310,
+    459749, 449306, 438978, 428762, 418657, 408658, 398764, 388972,
+    379280, 369686, 360187, 350782, 341467, 332242, 323105, 314053,
+    305085, 296199, 287394, 278668, 270018, 261445, 252946, 244520,
+    236165, 227881, 219665, 211517, 203435, 195419, 187466, 179577,
+    171749, 163982, 156274, 148626, 141035, 133500, 126022, 118598,
+    111228, 103911, 96647, 89434, 82271, 75158, 68095, 61079,
+    54112, 47191, 40316, 33487, 26702, 19962, 13265, 6612,
+    0, -6570, -13099, -19587, -26035, -32444, -38814, -45145,
+    -51439, -57695, -63915, -70098, -76245, -82357, -88433, -94476,
+    -100484,
+};
 
 bool bme280_init(bme280_t *dev, i2c_inst_t *i2c, uint8_t address)
 {
   dev->i2c = i2c;
   dev->address = address;
   dev->spi = NULL;
+  dev->dma = NULL;
+  dev->measurement_pending = false;
 
   uint8_t id = read8(dev, BME280_REGISTER_CHIPID);
   if (id != 0x60)
@@ -29,7 +87,7 @@ bool bme280_init(bme280_t *dev, i2c_inst_t *i2c, uint8_t address)
   while (isReadingCalibration(dev))
     sleep_ms(10);
 
-  readCoefficients(dev);
+  readCoefficients(dev, id);
   bme280_set_sampling(dev, MODE_NORMAL, SAMPLING_X16, SAMPLING_X16, SAMPLING_X16, FILTER_OFF, STANDBY_MS_0_5);
 
   return true;
@@ -38,6 +96,8 @@ bool bme280_init(bme280_t *dev, i2c_inst_t *i2c, uint8_t address)
 bool bme280_init_spi(bme280_t *dev, spi_inst_t *spi, uint8_t cs_pin)
 {
   dev->spi = spi;
+  dev->dma = NULL;
+  dev->measurement_pending = false;
   gpio_init(cs_pin);
   gpio_set_dir(cs_pin, GPIO_OUT);
   gpio_put(cs_pin, 1);
@@ -52,7 +112,7 @@ bool bme280_init_spi(bme280_t *dev, spi_inst_t *spi, uint8_t cs_pin)
   while (isReadingCalibration(dev))
     sleep_ms(10);
 
-  readCoefficients(dev);
+  readCoefficients(dev, id);
   bme280_set_sampling(dev, MODE_NORMAL, SAMPLING_X16, SAMPLING_X16, SAMPLING_X16, FILTER_OFF, STANDBY_MS_0_5);
 
   return true;
@@ -79,58 +139,96 @@ bool bme280_take_forced_measurement(bme280_t *dev)
 
   write8(dev, BME280_REGISTER_CONTROL, (dev->temp_sampling << 5) | (dev->press_sampling << 2) | MODE_FORCED);
 
+  // The conversion cannot complete before t_measure, only poll the status register after that
   uint32_t start = to_ms_since_boot(get_absolute_time());
+  sleep_us(bme280_measurement_time_us(dev));
   while (read8(dev, BME280_REGISTER_STATUS) & 0x08)
   {
-    if (to_ms_since_boot(get_absolute_time()) - start > 2000)
+    if (to_ms_since_boot(get_absolute_time()) - start > BME280_FORCED_TIMEOUT_MS)
       return false;
     sleep_ms(1);
   }
   return true;
 }
 
-float bme280_read_temperature(bme280_t *dev)
+// Start a forced conversion and return immediately, an alarm reads and compensates the result
+// once the conversion is due and passes it to callback from the alarm IRQ.
+// The bus must not be used by other code on this core's IRQ or thread level until the callback ran.
+bool bme280_start_forced_measurement(bme280_t *dev, uint32_t seaLevelPa, bme280_sample_callback_t callback, void *user_data)
 {
-  int32_t var1, var2;
-
-  int32_t adc_T = read24(dev, BME280_REGISTER_TEMPDATA_MSB) >> 4;
+  if (dev->mode != MODE_FORCED || dev->measurement_pending)
+    return false;
 
-  var1 = ((((adc_T >> 3) - ((int32_t)dev->calib_data.dig_T1 << 1))) * ((int32_t)dev->calib_data.dig_T2)) >> 11;
-  var2 = (((((adc_T >> 4) - ((int32_t)dev->calib_data.dig_T1)) * ((adc_T >> 4) - ((int32_t)dev->calib_data.dig_T1))) >> 12) * ((int32_t)dev->calib_data.dig_T3)) >> 14;
+  dev->sea_level_pa = seaLevelPa;
+  dev->sample_callback = callback;
+  dev->sample_callback_data = user_data;
+  dev->measurement_pending = true;
 
-  dev->t_fine = var1 + var2 + dev->t_fine_adjust;
+  uint8_t control = (dev->temp_sampling << 5) | (dev->press_sampling << 2) | MODE_FORCED;
+  if (dev->dma)
+  {
+    // Queued behind any transfer in flight, this can be called from the alarm IRQ of another sensor
+    uint8_t buffer[2] = {BME280_REGISTER_CONTROL, control};
+    dev->bus_transactions++;
+    if (!i2c_dma_write(dev->dma, dev->address, buffer, 2, NULL, NULL))
+    {
+      dev->measurement_pending = false;
+      return false;
+    }
+  }
+  else
+  {
+    write8(dev, BME280_REGISTER_CONTROL, control);
+  }
 
-  float T = (dev->t_fine * 5 + 128) >> 8;
+  dev->measurement_deadline = make_timeout_time_ms(BME280_FORCED_TIMEOUT_MS);
+  dev->alarm_id = add_alarm_in_us(bme280_measurement_time_us(dev), forcedMeasurementAlarm, dev, true);
+  if (dev->alarm_id < 0)
+  {
+    dev->measurement_pending = false;
+    return false;
+  }
+  return true;
+}
 
-  return T / 100.0;
+void bme280_cancel_forced_measurement(bme280_t *dev)
+{
+  if (dev->measurement_pending)
+  {
+    cancel_alarm(dev->alarm_id);
+    dev->measurement_pending = false;
+  }
 }
 
-float bme280_read_pressure(bme280_t *dev)
+// Maximum conversion time from the datasheet (section 9.1):
+// t_measure = 1.25 ms + 2.3 ms * T_os + (2.3 ms * P_os + 0.575 ms) + (2.3 ms * H_os + 0.575 ms)
+uint32_t bme280_measurement_time_us(bme280_t *dev)
 {
-  int64_t var1, var2, p;
+  uint32_t time_us = 1250 + 2300 * oversamplingCount(dev->temp_sampling);
 
-  bme280_read_temperature(dev);
+  if (dev->press_sampling != SAMPLING_NONE)
+    time_us += 2300 * oversamplingCount(dev->press_sampling) + 575;
+  if (dev->hum_sampling != SAMPLING_NONE)
+    time_us += 2300 * oversamplingCount(dev->hum_sampling) + 575;
 
-  int32_t adc_P = read24(dev, BME280_REGISTER_PRESSUREDATA_MSB) >> 4;
+  return time_us;
+}
 
-  var1 = ((int64_t)dev->t_fine) - 128000;
-  var2 = var1 * var1 * (int64_t)dev->calib_data.dig_P6;
-  var2 = var2 + ((var1 * (int64_t)dev->calib_data.dig_P5) << 17);
-  var2 = var2 + (((int64_t)dev->calib_data.dig_P4) << 35);
-  var1 = ((var1 * var1 * (int64_t)dev->calib_data.dig_P3) >> 8) + ((var1 * (int64_t)dev->calib_data.dig_P2) << 12);
-  var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)dev->calib_data.dig_P1) >> 33;
+#if BME280_FLOAT_API
+float bme280_read_temperature(bme280_t *dev)
+{
+  int32_t adc_T = read24(dev, BME280_REGISTER_TEMPDATA_MSB) >> 4;
 
-  if (var1 == 0)
-    return 0;
+  return compensate_temperature(dev, adc_T) / 100.0;
+}
 
-  p = 1048576 - adc_P;
-  p = (((p << 31) - var2) * 3125) / var1;
-  var1 = (((int64_t)dev->calib_data.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
-  var2 = (((int64_t)dev->calib_data.dig_P8) * p) >> 19;
+float bme280_read_pressure(bme280_t *dev)
+{
+  bme280_read_temperature(dev);
 
-  p = ((p + var1 + var2) >> 8) + (((int64_t)dev->calib_data.dig_P7) << 4);
+  int32_t adc_P = read24(dev, BME280_REGISTER_PRESSUREDATA_MSB) >> 4;
 
-  return (float)p / 256;
+  return (float)compensate_pressure(dev, adc_P) / 256;
 }
 
 float bme280_read_humidity(bme280_t *dev)
@@ -139,15 +237,7 @@ float bme280_read_humidity(bme280_t *dev)
 
   int32_t adc_H = read16(dev, BME280_REGISTER_HUMIDDATA_MSB);
 
-  int32_t v_x1_u32r = dev->t_fine - ((int32_t)76800);
-
-  v_x1_u32r = (((((adc_H << 14) - (((int32_t)dev->calib_data.dig_H4) << 20) - (((int32_t)dev->calib_data.dig_H5) * v_x1_u32r)) + ((int32_t)16384)) >> 15) * (((((((v_x1_u32r * ((int32_t)dev->calib_data.dig_H6)) >> 10) * (((v_x1_u32r * ((int32_t)dev->calib_data.dig_H3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * ((int32_t)dev->calib_data.dig_H2) + 8192) >> 14));
-
-  v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) * ((int32_t)dev->calib_data.dig_H1)) >> 4));
-  v_x1_u32r = (v_x1_u32r < 0 ? 0 : v_x1_u32r);
-  v_x1_u32r = (v_x1_u32r > 419430400 ? 419430400 : v_x1_u32r);
-
-  return (float)(v_x1_u32r >> 12) / 1024.0;
+  return (float)compensate_humidity(dev, adc_H) / 1024.0;
 }
 
 float bme280_read_altitude(bme280_t *dev, float seaLevel)
@@ -156,10 +246,109 @@ float bme280_read_altitude(bme280_t *dev, float seaLevel)
   return 44330.0 * (1.0 - pow(pressure / seaLevel, 0.1903));
 }
 
+// Read pressure, temperature and humidity with a single burst read of 0xF7..0xFE,
+// all values are compensated with the same t_fine
+bool bme280_read_all(bme280_t *dev, bme280_sample_t *sample, float seaLevel)
+{
+  uint8_t buffer[BME280_SAMPLE_LEN];
+
+  readN(dev, BME280_REGISTER_PRESSUREDATA_MSB, buffer, BME280_SAMPLE_LEN);
+
+  return bme280_compensate(dev, buffer, sample, seaLevel);
+}
+
+// Compensate a raw 0xF7..0xFE burst, returns false if no measurement has completed yet
+bool bme280_compensate(bme280_t *dev, const uint8_t *data, bme280_sample_t *sample, float seaLevel)
+{
+  bme280_sample_fixed_t fixed;
+
+  if (!bme280_compensate_fixed(dev, data, &fixed, 0))
+    return false;
+
+  sample->temperature = fixed.temperature / 100.0;
+  sample->pressure = (float)fixed.pressure / 256;
+  sample->humidity = (float)fixed.humidity / 1024.0;
+  sample->altitude = 44330.0 * (1.0 - pow(sample->pressure / 100.0 / seaLevel, 0.1903));
+
+  return true;
+}
+
 float bme280_sea_level_for_altitude(bme280_t *dev, float altitude, float pressure)
 {
   return pressure / pow(1.0 - (altitude / 44330.0), 5.255);
 }
+#endif
+
+// Burst read the BME280_SAMPLE_LEN raw data registers for bme280_compensate / bme280_compensate_fixed
+void bme280_read_raw(bme280_t *dev, uint8_t *data)
+{
+  readN(dev, BME280_REGISTER_PRESSUREDATA_MSB, data, BME280_SAMPLE_LEN);
+}
+
+// Route the forced measurement readout and bme280_read_raw_async through a DMA driven bus,
+// blocking reads and writes wait for the bus queue to drain first
+void bme280_attach_dma(bme280_t *dev, i2c_dma_t *dma)
+{
+  dev->dma = dma;
+}
+
+// Queue a burst read of the BME280_SAMPLE_LEN raw data registers, data must stay valid until callback
+bool bme280_read_raw_async(bme280_t *dev, uint8_t *data, i2c_dma_callback_t callback, void *user_data)
+{
+  uint8_t reg = BME280_REGISTER_PRESSUREDATA_MSB;
+
+  if (!dev->dma)
+    return false;
+
+  dev->bus_transactions++;
+  return i2c_dma_write_read(dev->dma, dev->address, &reg, 1, data, BME280_SAMPLE_LEN, callback, user_data);
+}
+
+bool bme280_read_all_fixed(bme280_t *dev, bme280_sample_fixed_t *sample, uint32_t seaLevelPa)
+{
+  uint8_t buffer[BME280_SAMPLE_LEN];
+
+  readN(dev, BME280_REGISTER_PRESSUREDATA_MSB, buffer, BME280_SAMPLE_LEN);
+
+  return bme280_compensate_fixed(dev, buffer, sample, seaLevelPa);
+}
+
+// Integer only version of bme280_compensate, the altitude is skipped when seaLevelPa is 0
+bool bme280_compensate_fixed(bme280_t *dev, const uint8_t *data, bme280_sample_fixed_t *sample, uint32_t seaLevelPa)
+{
+  int32_t adc_P = ((uint32_t)data[0] << 12) | ((uint32_t)data[1] << 4) | (data[2] >> 4);
+  int32_t adc_T = ((uint32_t)data[3] << 12) | ((uint32_t)data[4] << 4) | (data[5] >> 4);
+  int32_t adc_H = ((uint32_t)data[6] << 8) | data[7];
+
+  // 0x80000 is the reset value of the pressure and temperature registers, no measurement has completed yet
+  if (adc_T == 0x80000)
+    return false;
+
+  sample->temperature = compensate_temperature(dev, adc_T);
+  sample->pressure = compensate_pressure(dev, adc_P);
+  sample->humidity = compensate_humidity(dev, adc_H);
+  sample->altitude = seaLevelPa ? bme280_altitude_fixed(sample->pressure, seaLevelPa) : 0;
+
+  return true;
+}
+
+// Altitude in cm from pressure in 1/256 Pa, see altitude_table for the error bound
+int32_t bme280_altitude_fixed(uint32_t pressure, uint32_t seaLevelPa)
+{
+  uint32_t ratio = (uint32_t)(((uint64_t)pressure << 12) / seaLevelPa); // Q20
+
+  if (ratio <= ALTITUDE_TABLE_RATIO_MIN)
+    return altitude_table[0];
+
+  uint32_t index = (ratio - ALTITUDE_TABLE_RATIO_MIN) / ALTITUDE_TABLE_STEP;
+  if (index >= ALTITUDE_TABLE_LEN - 1)
+    return altitude_table[ALTITUDE_TABLE_LEN - 1];
+
+  int32_t fraction = (ratio - ALTITUDE_TABLE_RATIO_MIN) % ALTITUDE_TABLE_STEP;
+  int32_t delta = altitude_table[index + 1] - altitude_table[index];
+
+  return altitude_table[index] + delta * fraction / ALTITUDE_TABLE_STEP;
+}
 
 uint32_t bme280_sensor_id(bme280_t *dev)
 {
@@ -176,114 +365,311 @@ void bme280_set_temperature_compensation(bme280_t *dev, float adjustment)
   dev->t_fine_adjust = (int32_t)(adjustment * 100) << 8 / 5;
 }
 
-static uint8_t read8(bme280_t *dev, uint8_t reg)
+// Returns temperature in 0.01 degrees C and updates t_fine
+static int32_t compensate_temperature(bme280_t *dev, int32_t adc_T)
 {
-  uint8_t value;
+  int32_t var1, var2;
+
+  var1 = ((((adc_T >> 3) - ((int32_t)dev->calib_data.dig_T1 << 1))) * ((int32_t)dev->calib_data.dig_T2)) >> 11;
+  var2 = (((((adc_T >> 4) - ((int32_t)dev->calib_data.dig_T1)) * ((adc_T >> 4) - ((int32_t)dev->calib_data.dig_T1))) >> 12) * ((int32_t)dev->calib_data.dig_T3)) >> 14;
+
+  dev->t_fine = var1 + var2 + dev->t_fine_adjust;
+
+  return (dev->t_fine * 5 + 128) >> 8;
+}
+
+// Returns pressure in Pa as Q24.8 (Pa * 256), requires an up to date t_fine
+static uint32_t compensate_pressure(bme280_t *dev, int32_t adc_P)
+{
+  int64_t var1, var2, p;
+
+  var1 = ((int64_t)dev->t_fine) - 128000;
+  var2 = var1 * var1 * (int64_t)dev->calib_data.dig_P6;
+  var2 = var2 + ((var1 * (int64_t)dev->calib_data.dig_P5) << 17);
+  var2 = var2 + (((int64_t)dev->calib_data.dig_P4) << 35);
+  var1 = ((var1 * var1 * (int64_t)dev->calib_data.dig_P3) >> 8) + ((var1 * (int64_t)dev->calib_data.dig_P2) << 12);
+  var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)dev->calib_data.dig_P1) >> 33;
+
+  if (var1 == 0)
+    return 0;
+
+  p = 1048576 - adc_P;
+  p = (((p << 31) - var2) * 3125) / var1;
+  var1 = (((int64_t)dev->calib_data.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+  var2 = (((int64_t)dev->calib_data.dig_P8) * p) >> 19;
+
+  p = ((p + var1 + var2) >> 8) + (((int64_t)dev->calib_data.dig_P7) << 4);
+
+  return (uint32_t)p;
+}
+
+// Returns humidity in %RH as Q22.10 (%RH * 1024), requires an up to date t_fine
+static uint32_t compensate_humidity(bme280_t *dev, int32_t adc_H)
+{
+  int32_t v_x1_u32r = dev->t_fine - ((int32_t)76800);
+
+  v_x1_u32r = (((((adc_H << 14) - (((int32_t)dev->calib_data.dig_H4) << 20) - (((int32_t)dev->calib_data.dig_H5) * v_x1_u32r)) + ((int32_t)16384)) >> 15) * (((((((v_x1_u32r * ((int32_t)dev->calib_data.dig_H6)) >> 10) * (((v_x1_u32r * ((int32_t)dev->calib_data.dig_H3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * ((int32_t)dev->calib_data.dig_H2) + 8192) >> 14));
+
+  v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) * ((int32_t)dev->calib_data.dig_H1)) >> 4));
+  v_x1_u32r = (v_x1_u32r < 0 ? 0 : v_x1_u32r);
+  v_x1_u32r = (v_x1_u32r > 419430400 ? 419430400 : v_x1_u32r);
+
+  return (uint32_t)(v_x1_u32r >> 12);
+}
+
+static void readN(bme280_t *dev, uint8_t reg, uint8_t *buffer, uint8_t len)
+{
+  if (dev->dma)
+    i2c_dma_wait_idle(dev->dma);
+
+  dev->bus_transactions++;
   if (dev->spi)
   {
     gpio_put(dev->address, 0);
     spi_write_blocking(dev->spi, &reg, 1);
-    spi_read_blocking(dev->spi, 0, &value, 1);
+    spi_read_blocking(dev->spi, 0, buffer, len);
     gpio_put(dev->address, 1);
   }
   else
   {
     i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
-    i2c_read_blocking(dev->i2c, dev->address, &value, 1, false);
+    i2c_read_blocking(dev->i2c, dev->address, buffer, len, false);
   }
+}
+
+static uint8_t read8(bme280_t *dev, uint8_t reg)
+{
+  uint8_t value;
+  readN(dev, reg, &value, 1);
   return value;
 }
 
 static uint16_t read16(bme280_t *dev, uint8_t reg)
 {
   uint8_t buffer[2];
-  if (dev->spi)
-  {
-    gpio_put(dev->address, 0);
-    spi_write_blocking(dev->spi, &reg, 1);
-    spi_read_blocking(dev->spi, 0, buffer, 2);
-    gpio_put(dev->address, 1);
-  }
-  else
-  {
-    i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
-    i2c_read_blocking(dev->i2c, dev->address, buffer, 2, false);
-  }
+  readN(dev, reg, buffer, 2);
   return (buffer[0] << 8) | buffer[1];
 }
 
 static uint32_t read24(bme280_t *dev, uint8_t reg)
 {
   uint8_t buffer[3];
+  readN(dev, reg, buffer, 3);
+  return (buffer[0] << 16) | (buffer[1] << 8) | buffer[2];
+}
+
+static int16_t readS16(bme280_t *dev, uint8_t reg)
+{
+  return (int16_t)read16(dev, reg);
+}
+
+static void write8(bme280_t *dev, uint8_t reg, uint8_t value)
+{
+  uint8_t buffer[2] = {reg, value};
+  if (dev->dma)
+    i2c_dma_wait_idle(dev->dma);
+
+  dev->bus_transactions++;
   if (dev->spi)
   {
     gpio_put(dev->address, 0);
-    spi_write_blocking(dev->spi, &reg, 1);
-    spi_read_blocking(dev->spi, 0, buffer, 3);
+    spi_write_blocking(dev->spi, buffer, 2);
     gpio_put(dev->address, 1);
   }
   else
   {
-    i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
-    i2c_read_blocking(dev->i2c, dev->address, buffer, 3, false);
+    i2c_write_blocking(dev->i2c, dev->address, buffer, 2, false);
   }
-  return (buffer[0] << 16) | (buffer[1] << 8) | buffer[2];
 }
 
-static int16_t readS16(bme280_t *dev, uint8_t reg)
+// Calibration is read as two bursts, 0x88..0xA1 and 0xE1..0xE7, and unpacked from the buffer.
+// With the cache only the short 0xE1..0xE7 burst is read, it identifies the cached entry
+static void readCoefficients(bme280_t *dev, uint8_t chip_id)
 {
-  return (int16_t)read16(dev, reg);
+  uint8_t calib[BME280_CALIB_BLOCK1_LEN + BME280_CALIB_BLOCK2_LEN];
+
+  readN(dev, BME280_REGISTER_DIG_H2, calib + BME280_CALIB_BLOCK1_LEN, BME280_CALIB_BLOCK2_LEN);
+
+#if BME280_CALIB_CACHE
+  dev->calib_from_cache = !dev->spi && loadCachedCoefficients(dev, chip_id, calib);
+  if (dev->calib_from_cache)
+  {
+    unpackCoefficients(dev, calib);
+    return;
+  }
+#else
+  (void)chip_id;
+  dev->calib_from_cache = false;
+#endif
+
+  readN(dev, BME280_REGISTER_DIG_T1, calib, BME280_CALIB_BLOCK1_LEN);
+  unpackCoefficients(dev, calib);
+
+#if BME280_CALIB_CACHE
+  if (!dev->spi)
+    storeCachedCoefficients(dev, chip_id, calib);
+#endif
 }
 
-static uint16_t read16_LE(bme280_t *dev, uint8_t reg)
+static void unpackCoefficients(bme280_t *dev, const uint8_t *calib)
 {
-  uint16_t temp = read16(dev, reg);
-  return (temp >> 8) | (temp << 8);
+  const uint8_t *cal1 = calib;                           // 0x88..0xA1
+  const uint8_t *cal2 = calib + BME280_CALIB_BLOCK1_LEN; // 0xE1..0xE7
+
+  dev->calib_data.dig_T1 = (uint16_t)(cal1[1] << 8 | cal1[0]);
+  dev->calib_data.dig_T2 = (int16_t)(cal1[3] << 8 | cal1[2]);
+  dev->calib_data.dig_T3 = (int16_t)(cal1[5] << 8 | cal1[4]);
+  dev->calib_data.dig_P1 = (uint16_t)(cal1[7] << 8 | cal1[6]);
+  dev->calib_data.dig_P2 = (int16_t)(cal1[9] << 8 | cal1[8]);
+  dev->calib_data.dig_P3 = (int16_t)(cal1[11] << 8 | cal1[10]);
+  dev->calib_data.dig_P4 = (int16_t)(cal1[13] << 8 | cal1[12]);
+  dev->calib_data.dig_P5 = (int16_t)(cal1[15] << 8 | cal1[14]);
+  dev->calib_data.dig_P6 = (int16_t)(cal1[17] << 8 | cal1[16]);
+  dev->calib_data.dig_P7 = (int16_t)(cal1[19] << 8 | cal1[18]);
+  dev->calib_data.dig_P8 = (int16_t)(cal1[21] << 8 | cal1[20]);
+  dev->calib_data.dig_P9 = (int16_t)(cal1[23] << 8 | cal1[22]);
+  dev->calib_data.dig_H1 = cal1[25];
+  dev->calib_data.dig_H2 = (int16_t)(cal2[1] << 8 | cal2[0]);
+  dev->calib_data.dig_H3 = cal2[2];
+  dev->calib_data.dig_H4 = (cal2[3] << 4) | (cal2[4] & 0xF);
+  dev->calib_data.dig_H5 = (cal2[5] << 4) | (cal2[4] >> 4);
+  dev->calib_data.dig_H6 = (int8_t)cal2[6];
 }
 
-static int16_t readS16_LE(bme280_t *dev, uint8_t reg)
+#if BME280_CALIB_CACHE
+// calib holds the 0xE1..0xE7 block read from the sensor, the humidity coefficients in it differ
+// between parts, so a sensor swapped in at the same address does not match the old entry
+static bool loadCachedCoefficients(bme280_t *dev, uint8_t chip_id, uint8_t *calib)
 {
-  return (int16_t)read16_LE(dev, reg);
+  const bme280_calib_cache_entry *entry = (const bme280_calib_cache_entry *)(XIP_BASE + BME280_CALIB_CACHE_OFFSET);
+
+  for (uint8_t i = 0; i < BME280_CALIB_CACHE_SLOTS; i++, entry++)
+  {
+    if (entry->magic == BME280_CALIB_CACHE_MAGIC && entry->chip_id == chip_id && entry->address == dev->address &&
+        memcmp(entry->calib + BME280_CALIB_BLOCK1_LEN, calib + BME280_CALIB_BLOCK1_LEN, BME280_CALIB_BLOCK2_LEN) == 0)
+    {
+      memcpy(calib, entry->calib, BME280_CALIB_BLOCK1_LEN);
+      return true;
+    }
+  }
+  return false;
 }
 
-static void write8(bme280_t *dev, uint8_t reg, uint8_t value)
+static void programCachePage(void *page)
 {
-  uint8_t buffer[2] = {reg, value};
-  if (dev->spi)
+  flash_range_erase(BME280_CALIB_CACHE_OFFSET, FLASH_SECTOR_SIZE);
+  flash_range_program(BME280_CALIB_CACHE_OFFSET, (const uint8_t *)page, FLASH_PAGE_SIZE);
+}
+
+static void storeCachedCoefficients(bme280_t *dev, uint8_t chip_id, const uint8_t *calib)
+{
+  static uint8_t page[FLASH_PAGE_SIZE];
+  bme280_calib_cache_entry *entries = (bme280_calib_cache_entry *)page;
+  uint8_t slot = BME280_CALIB_CACHE_SLOTS;
+
+  memcpy(page, (const void *)(XIP_BASE + BME280_CALIB_CACHE_OFFSET), FLASH_PAGE_SIZE);
+
+  // Reuse the slot of this address, otherwise take the first free slot, otherwise overwrite the first slot
+  for (uint8_t i = 0; i < BME280_CALIB_CACHE_SLOTS && slot == BME280_CALIB_CACHE_SLOTS; i++)
   {
-    gpio_put(dev->address, 0);
-    spi_write_blocking(dev->spi, buffer, 2);
-    gpio_put(dev->address, 1);
+    if (entries[i].magic == BME280_CALIB_CACHE_MAGIC && entries[i].address == dev->address)
+      slot = i;
   }
-  else
+  for (uint8_t i = 0; i < BME280_CALIB_CACHE_SLOTS && slot == BME280_CALIB_CACHE_SLOTS; i++)
   {
-    i2c_write_blocking(dev->i2c, dev->address, buffer, 2, false);
+    if (entries[i].magic != BME280_CALIB_CACHE_MAGIC)
+      slot = i;
   }
-}
+  if (slot == BME280_CALIB_CACHE_SLOTS)
+    slot = 0;
 
-static void readCoefficients(bme280_t *dev)
-{
-  dev->calib_data.dig_T1 = read16_LE(dev, BME280_REGISTER_DIG_T1);
-  dev->calib_data.dig_T2 = readS16_LE(dev, BME280_REGISTER_DIG_T2);
-  dev->calib_data.dig_T3 = readS16_LE(dev, BME280_REGISTER_DIG_T3);
-  dev->calib_data.dig_P1 = read16_LE(dev, BME280_REGISTER_DIG_P1);
-  dev->calib_data.dig_P2 = readS16_LE(dev, BME280_REGISTER_DIG_P2);
-  dev->calib_data.dig_P3 = readS16_LE(dev, BME280_REGISTER_DIG_P3);
-  dev->calib_data.dig_P4 = readS16_LE(dev, BME280_REGISTER_DIG_P4);
-  dev->calib_data.dig_P5 = readS16_LE(dev, BME280_REGISTER_DIG_P5);
-  dev->calib_data.dig_P6 = readS16_LE(dev, BME280_REGISTER_DIG_P6);
-  dev->calib_data.dig_P7 = readS16_LE(dev, BME280_REGISTER_DIG_P7);
-  dev->calib_data.dig_P8 = readS16_LE(dev, BME280_REGISTER_DIG_P8);
-  dev->calib_data.dig_P9 = readS16_LE(dev, BME280_REGISTER_DIG_P9);
-  dev->calib_data.dig_H1 = read8(dev, BME280_REGISTER_DIG_H1);
-  dev->calib_data.dig_H2 = readS16_LE(dev, BME280_REGISTER_DIG_H2);
-  dev->calib_data.dig_H3 = read8(dev, BME280_REGISTER_DIG_H3);
-  dev->calib_data.dig_H4 = (read8(dev, BME280_REGISTER_DIG_H4) << 4) | (read8(dev, BME280_REGISTER_DIG_H4 + 1) & 0xF);
-  dev->calib_data.dig_H5 = (read8(dev, BME280_REGISTER_DIG_H5 + 1) << 4) | (read8(dev, BME280_REGISTER_DIG_H5) >> 4);
-  dev->calib_data.dig_H6 = (int8_t)read8(dev, BME280_REGISTER_DIG_H6);
+  entries[slot].magic = BME280_CALIB_CACHE_MAGIC;
+  entries[slot].chip_id = chip_id;
+  entries[slot].address = dev->address;
+  memcpy(entries[slot].calib, calib, sizeof(entries[slot].calib));
+
+  // Failing to write the cache is not fatal, the next boot reads the calibration from the sensor again
+  flash_safe_execute(programCachePage, page, 100);
 }
+#endif
 
 static bool isReadingCalibration(bme280_t *dev)
 {
   return (read8(dev, BME280_REGISTER_STATUS) & (1 << 0)) != 0;
-}
\ No newline at end of file
+}
+
+static uint8_t oversamplingCount(sensor_sampling sampling)
+{
+  return sampling == SAMPLING_NONE ? 0 : 1 << (sampling - 1);
+}
+
+static int64_t forcedMeasurementAlarm(alarm_id_t id, void *user_data)
+{
+  bme280_t *dev = (bme280_t *)user_data;
+  uint8_t raw[BME280_SAMPLE_LEN];
+
+  if (dev->dma)
+  {
+    // Status and data in one queued transfer, forcedReadDone takes over from the I2C IRQ
+    uint8_t reg = BME280_REGISTER_STATUS;
+    dev->bus_transactions++;
+    if (!i2c_dma_write_read(dev->dma, dev->address, &reg, 1, dev->forced_raw, BME280_FORCED_READ_LEN, forcedReadDone, dev))
+      completeForcedMeasurement(dev, NULL);
+    return 0;
+  }
+
+  // The conversion can run slightly past t_measure, poll again shortly until the deadline
+  if (read8(dev, BME280_REGISTER_STATUS) & 0x08)
+  {
+    if (!time_reached(dev->measurement_deadline))
+      return -BME280_FORCED_POLL_US;
+    completeForcedMeasurement(dev, NULL);
+    return 0;
+  }
+
+  readN(dev, BME280_REGISTER_PRESSUREDATA_MSB, raw, BME280_SAMPLE_LEN);
+  completeForcedMeasurement(dev, raw);
+  return 0;
+}
+
+static void forcedReadDone(bool success, void *user_data)
+{
+  bme280_t *dev = (bme280_t *)user_data;
+
+  // Cancelled while the read was on the bus
+  if (!dev->measurement_pending)
+    return;
+
+  if (!success)
+  {
+    completeForcedMeasurement(dev, NULL);
+  }
+  else if (dev->forced_raw[0] & 0x08)
+  {
+    // Keep the id current so bme280_cancel_forced_measurement cancels the re-poll
+    if (time_reached(dev->measurement_deadline))
+    {
+      completeForcedMeasurement(dev, NULL);
+      return;
+    }
+    dev->alarm_id = add_alarm_in_us(BME280_FORCED_POLL_US, forcedMeasurementAlarm, dev, true);
+    if (dev->alarm_id < 0)
+      completeForcedMeasurement(dev, NULL);
+  }
+  else
+  {
+    completeForcedMeasurement(dev, dev->forced_raw + (BME280_REGISTER_PRESSUREDATA_MSB - BME280_REGISTER_STATUS));
+  }
+}
+
+// raw is NULL if the conversion did not complete
+static void completeForcedMeasurement(bme280_t *dev, const uint8_t *raw)
+{
+  bme280_sample_fixed_t sample;
+  bool valid = raw && bme280_compensate_fixed(dev, raw, &sample, dev->sea_level_pa);
+
+  // Clear the pending flag first so the callback can start the next conversion
+  dev->measurement_pending = false;
+  if (dev->sample_callback)
+    dev->sample_callback(dev, valid ? &sample : NULL, dev->sample_callback_data);
+}
@@ -5,10 +5,32 @@
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "hardware/spi.h"
+#include "i2c_dma.h"
 
 #define BME280_ADDRESS (0x77)
 #define BME280_ADDRESS_ALTERNATE (0x76)
 
+// Set to 1 to keep calibration data in the last flash sector so warm boots skip the calibration reads.
+// Entries are keyed by I2C address and the 0xE1..0xE7 calibration block, which is still read on every
+// init, so a sensor swapped in at the same address reads its own calibration.
+// Requires pico_flash and the other core to be flash safe (flash_safe_execute_core_init or multicore_lockout_victim_init)
+#ifndef BME280_CALIB_CACHE
+#define BME280_CALIB_CACHE 0
+#endif
+
+// Set to 0 to compile out the float API so only the integer compensation path is linked
+#ifndef BME280_FLOAT_API
+#define BME280_FLOAT_API 1
+#endif
+
+#define BME280_FORCED_TIMEOUT_MS 2000 // Give up on a forced conversion after this long
+#define BME280_FORCED_POLL_US 500     // Status poll interval once t_measure has passed
+
+#define BME280_SAMPLE_LEN 8        // 0xF7..0xFE
+#define BME280_FORCED_READ_LEN 12  // 0xF3..0xFE, status and data in one transfer when using DMA
+#define BME280_CALIB_BLOCK1_LEN 26 // 0x88..0xA1
+#define BME280_CALIB_BLOCK2_LEN 7  // 0xE1..0xE7
+
 enum
 {
   BME280_REGISTER_DIG_T1 = 0x88,
@@ -113,6 +135,28 @@ typedef enum
 } standby_duration;
 
 typedef struct
+{
+  float temperature; // degrees C
+  float pressure;    // Pa
+  float humidity;    // %RH
+  float altitude;    // m
+} bme280_sample_t;
+
+typedef struct
+{
+  int32_t temperature; // 0.01 degrees C
+  uint32_t pressure;   // 1/256 Pa
+  uint32_t humidity;   // 1/1024 %RH
+  int32_t altitude;    // cm
+} bme280_sample_fixed_t;
+
+typedef struct bme280 bme280_t;
+
+// Called from the alarm IRQ once a forced measurement started by bme280_start_forced_measurement
+// has been read, sample is NULL if the conversion did not complete in time
+typedef void (*bme280_sample_callback_t)(bme280_t *dev, const bme280_sample_fixed_t *sample, void *user_data);
+
+struct bme280
 {
   i2c_inst_t *i2c;
   spi_inst_t *spi;
@@ -127,17 +171,40 @@ typedef struct
   sensor_sampling hum_sampling;
   sensor_filter filter;
   standby_duration duration;
-} bme280_t;
+  uint32_t bus_transactions;
+  bool calib_from_cache;
+  volatile bool measurement_pending;
+  alarm_id_t alarm_id;
+  absolute_time_t measurement_deadline;
+  uint32_t sea_level_pa;
+  bme280_sample_callback_t sample_callback;
+  void *sample_callback_data;
+  i2c_dma_t *dma;
+  uint8_t forced_raw[BME280_FORCED_READ_LEN];
+};
 
 bool bme280_init(bme280_t *dev, i2c_inst_t *i2c, uint8_t address);
 bool bme280_init_spi(bme280_t *dev, spi_inst_t *spi, uint8_t cs_pin);
 void bme280_set_sampling(bme280_t *dev, sensor_mode mode, sensor_sampling tempSampling, sensor_sampling pressSampling, sensor_sampling humSampling, sensor_filter filter, standby_duration duration);
 bool bme280_take_forced_measurement(bme280_t *dev);
+bool bme280_start_forced_measurement(bme280_t *dev, uint32_t seaLevelPa, bme280_sample_callback_t callback, void *user_data);
+void bme280_cancel_forced_measurement(bme280_t *dev);
+uint32_t bme280_measurement_time_us(bme280_t *dev);
+#if BME280_FLOAT_API
 float bme280_read_temperature(bme280_t *dev);
 float bme280_read_pressure(bme280_t *dev);
 float bme280_read_humidity(bme280_t *dev);
 float bme280_read_altitude(bme280_t *dev, float seaLevel);
+bool bme280_read_all(bme280_t *dev, bme280_sample_t *sample, float seaLevel);
+bool bme280_compensate(bme280_t *dev, const uint8_t *data, bme280_sample_t *sample, float seaLevel);
 float bme280_sea_level_for_altitude(bme280_t *dev, float altitude, float pressure);
+#endif
+void bme280_read_raw(bme280_t *dev, uint8_t *data);
+void bme280_attach_dma(bme280_t *dev, i2c_dma_t *dma);
+bool bme280_read_raw_async(bme280_t *dev, uint8_t *data, i2c_dma_callback_t callback, void *user_data);
+bool bme280_read_all_fixed(bme280_t *dev, bme280_sample_fixed_t *sample, uint32_t seaLevelPa);
+bool bme280_compensate_fixed(bme280_t *dev, const uint8_t *data, bme280_sample_fixed_t *sample, uint32_t seaLevelPa);
+int32_t bme280_altitude_fixed(uint32_t pressure, uint32_t seaLevelPa);
 uint32_t bme280_sensor_id(bme280_t *dev);
 float bme280_get_temperature_compensation(bme280_t *dev);
 void bme280_set_temperature_compensation(bme280_t *dev, float adjustment);
@@ -6,8 +6,10 @@
 #include "hardware/i2c.h"
 #include "hardware/spi.h"
 #include "hardware/dma.h"
+#include "hardware/clocks.h"
 #include "pico/cyw43_arch.h"
 #include "Adafruit_BME280.h"
+#include "BME280_group.h"
 #include "SparkFun_Alphanumeric_Display.h"
 
 #define SparkFun_I2C_PORT i2c1
@@ -17,27 +19,73 @@
 #define BME280_I2C_SDA_PIN 16
 #define BME280_I2C_SCL_PIN 17
 #define Sea_Level_Pressure_HPA (1013.25)
+#define TEST_READS 100
+#define TEST_COMPENSATIONS 10000
+#define TEST_GROUP_MS 2000
+#define TEST_REFRESHES 100
+#define TEST_PUBLISHES 1000
+#define TEST_FORMATS 1000
+#define DISPLAY_REFRESH_HZ 20
+
+// Start-up benchmarks of the sensor, hand-off and display paths. They add several seconds to every
+// boot and leave synthetic samples behind, so they are only built with -DRUN_BENCHMARKS=1, see
+// the BME280_MULTI_BENCHMARKS option in CMakeLists.txt.
+#ifndef RUN_BENCHMARKS
+#define RUN_BENCHMARKS 0
+#endif
 
 // Define onboard LED
 #ifndef PICO_DEFAULT_LED_PIN
 #define ONBOARD_LED_PIN CYW43_WL_GPIO_LED_PIN
 #endif
 
-// Global variables for sensor data
-volatile float temperature, pressure, altitude, humidity = 0.0F;
+// Sample block handed from core 0 to core 1
+typedef struct
+{
+    float temperature;
+    float pressure;
+    float altitude;
+    float humidity;
+    uint32_t timestamp_us;
+    uint32_t sequence;
+} sample_block_t;
+
+// Ping-pong sample blocks, core 0 fills the block core 1 is not reading and a chained
+// DMA transfer flips sample_index once the whole block has landed
+sample_block_t sample_blocks[2];
+volatile uint32_t sample_index = 0;
+sample_block_t sample_staging;
+uint32_t next_sample_index = 0;
 
 bme280_t bme;
 HT16K33 display;
 
-// DMA channel
+// DMA driven I2C transports, the display one is owned by core 1
+i2c_dma_t bme_dma;
+i2c_dma_t display_dma;
+
+// DMA channels, dma_chan copies the sample block and chains to dma_flip_chan
 int dma_chan;
+int dma_flip_chan;
 
 void setup_i2c();
 void setup_bme280();
 void setup_display();
+void show_greeting();
 void read_and_send_data();
 void core1_display_task();
 void setup_dma();
+void publish_sample(float temp, float pres, float alt, float hum);
+void read_latest_sample(sample_block_t *sample);
+#if RUN_BENCHMARKS
+void test_read_rate();
+void test_compensation_rate();
+void test_group_rate();
+void test_sample_cpu();
+void test_display_refresh_cpu();
+void test_publish_rate();
+void test_format_rate();
+#endif
 
 void setup_i2c()
 {
@@ -57,6 +105,17 @@ void setup_i2c()
             sleep_ms(1000);
         }
     }
+
+    // Display RAM writes go out through DMA from here on, the refresh timer depends on it
+    if (!i2c_dma_init(&display_dma, SparkFun_I2C_PORT))
+    {
+        while (1)
+        {
+            printf("No free DMA channels for the display\n");
+            sleep_ms(1000);
+        }
+    }
+    HT16K33_attachDMA(&display, &display_dma);
     printf("Display I2C initialized with baudrate: %d\n", baudrate);
 }
 
@@ -70,6 +129,7 @@ void setup_bme280()
     gpio_pull_up(BME280_I2C_SCL_PIN);
 
     // Initialize BME280 sensor
+    uint64_t start = time_us_64();
     if (!bme280_init(&bme, BME280_I2C_PORT, BME280_ADDRESS))
     {
         while (1)
@@ -78,162 +138,433 @@ void setup_bme280()
             sleep_ms(1000);
         }
     }
+    uint64_t end = time_us_64();
     printf("BME280 I2C initialized with baudrate: %d\n", baudrate);
+    printf("BME280 init time: %llu us, calibration from %s\n", end - start, bme.calib_from_cache ? "flash cache" : "sensor");
 }
 
 void setup_display()
 {
     HT16K33_clear(&display);
-    sleep_ms(250);
     HT16K33_setBlinkRate(&display, 0);
-    sleep_ms(250);
-    HT16K33_print(&display, "-HI-");
-    sleep_ms(250);
-    HT16K33_setBrightness(&display, 15);
-    sleep_ms(250);
-    HT16K33_setBrightness(&display, 0);
-    sleep_ms(250);
-    HT16K33_clear(&display);
+}
+
+// Greeting played by the animation engine once the refresh runs
+void show_greeting()
+{
+    const HT16K33_keyframe greeting[] = {
+        {HT16K33_ANIM_BRIGHTNESS, 0, 15, 15, 0, 500},
+        {HT16K33_ANIM_BRIGHTNESS, 0, 0, 0, 0, 250},
+    };
+
+    HT16K33_framePrint(&display, "-HI-");
+    HT16K33_submitFrame(&display);
+    HT16K33_startAnimation(&display, greeting, count_of(greeting), false);
 }
 
 void setup_dma()
 {
     dma_chan = dma_claim_unused_channel(true);
-    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    dma_flip_chan = dma_claim_unused_channel(true);
+
+    // Writes next_sample_index to sample_index, triggered by the end of the sample block copy
+    dma_channel_config c = dma_channel_get_default_config(dma_flip_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(dma_flip_chan, &c, &sample_index, &next_sample_index, 1, false);
+
+    c = dma_channel_get_default_config(dma_chan);
     channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
     channel_config_set_read_increment(&c, true);
     channel_config_set_write_increment(&c, true);
-    dma_channel_configure(dma_chan, &c, NULL, NULL, 0, false);
+    channel_config_set_chain_to(&c, dma_flip_chan);
+    dma_channel_configure(dma_chan, &c, NULL, &sample_staging, sizeof(sample_block_t) / 4, false);
+}
+
+void publish_sample(float temp, float pres, float alt, float hum)
+{
+    // The previous block must have landed and the index flipped before the staging block is reused
+    while (sample_index != next_sample_index)
+        tight_loop_contents();
+
+    sample_staging.temperature = temp;
+    sample_staging.pressure = pres;
+    sample_staging.altitude = alt;
+    sample_staging.humidity = hum;
+    sample_staging.timestamp_us = time_us_32();
+    sample_staging.sequence++;
+
+    next_sample_index = sample_index ^ 1;
+    // The staging stores must be complete before the DMA reads the block
+    __dmb();
+    dma_channel_set_read_addr(dma_chan, &sample_staging, false);
+    dma_channel_set_write_addr(dma_chan, &sample_blocks[next_sample_index], true);
+}
+
+// Called from core 1. The block at sample_index is not written while it is current, but if core 0
+// publishes twice during the copy the DMA rewrites it. The block's sequence, the last word the DMA
+// writes, is read before the copy and checked after it, so a block that was rewritten, even with
+// sample_index back at the same block, or that is still being rewritten makes the copy retry.
+void read_latest_sample(sample_block_t *sample)
+{
+    uint32_t index;
+    uint32_t sequence;
+
+    do
+    {
+        index = sample_index;
+        __dmb();
+        sequence = sample_blocks[index].sequence;
+        __dmb();
+        *sample = sample_blocks[index];
+        __dmb();
+    } while (sample_blocks[index].sequence != sequence || index != sample_index);
+}
+
+#if RUN_BENCHMARKS
+void test_read_rate()
+{
+    bme280_sample_t sample;
+
+    printf("test_read_rate per field reads\n");
+    uint32_t start_transactions = bme.bus_transactions;
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_READS; count++)
+    {
+        bme280_read_temperature(&bme);
+        bme280_read_pressure(&bme);
+        bme280_read_altitude(&bme, Sea_Level_Pressure_HPA);
+        bme280_read_humidity(&bme);
+    }
+    uint64_t end = time_us_64();
+    printf("Bus transactions per sample: %.2f\n", (float)(bme.bus_transactions - start_transactions) / TEST_READS);
+    printf("Average time per sample: %.2f us\n", (float)(end - start) / TEST_READS);
+
+    printf("test_read_rate burst read\n");
+    start_transactions = bme.bus_transactions;
+    start = time_us_64();
+    for (int count = 0; count < TEST_READS; count++)
+    {
+        bme280_read_all(&bme, &sample, Sea_Level_Pressure_HPA);
+    }
+    end = time_us_64();
+    printf("Bus transactions per sample: %.2f\n", (float)(bme.bus_transactions - start_transactions) / TEST_READS);
+    printf("Average time per sample: %.2f us\n", (float)(end - start) / TEST_READS);
+}
+
+void test_compensation_rate()
+{
+    uint8_t raw[BME280_SAMPLE_LEN];
+    bme280_sample_t sample;
+    bme280_sample_fixed_t sample_fixed;
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+
+    bme280_read_raw(&bme, raw);
+
+    printf("test_compensation_rate float\n");
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_COMPENSATIONS; count++)
+    {
+        bme280_compensate(&bme, raw, &sample, Sea_Level_Pressure_HPA);
+    }
+    uint64_t end = time_us_64();
+    float elapsed_us = (float)(end - start) / TEST_COMPENSATIONS;
+    printf("Average compensation time: %.2f us, %.0f cycles\n", elapsed_us, elapsed_us * cycles_per_us);
+
+    printf("test_compensation_rate fixed point\n");
+    start = time_us_64();
+    for (int count = 0; count < TEST_COMPENSATIONS; count++)
+    {
+        bme280_compensate_fixed(&bme, raw, &sample_fixed, (uint32_t)(Sea_Level_Pressure_HPA * 100));
+    }
+    end = time_us_64();
+    elapsed_us = (float)(end - start) / TEST_COMPENSATIONS;
+    printf("Average compensation time: %.2f us, %.0f cycles\n", elapsed_us, elapsed_us * cycles_per_us);
+}
+
+void test_group_rate()
+{
+    static bme280_t bme_alternate;
+    static bme280_group_t group;
+    bme280_t *sensors[2] = {&bme, &bme_alternate};
+    sensor_mode modes[2];
+    uint8_t number_of_sensors = 1;
+
+    if (bme280_init(&bme_alternate, BME280_I2C_PORT, BME280_ADDRESS_ALTERNATE))
+        number_of_sensors = 2;
+
+    // bme280_group_add switches the sensors to forced mode
+    for (uint8_t i = 0; i < number_of_sensors; i++)
+        modes[i] = sensors[i]->mode;
+
+    printf("test_group_rate\n");
+    bme280_group_init(&group, (uint32_t)(Sea_Level_Pressure_HPA * 100));
+    for (uint8_t i = 0; i < number_of_sensors; i++)
+    {
+        bme280_group_add(&group, sensors[i]);
+        uint32_t first_sequence = group.sequence;
+        bme280_group_start(&group);
+        sleep_ms(TEST_GROUP_MS);
+        float samples_per_second = bme280_group_samples_per_second(&group);
+        bme280_group_stop(&group);
+        printf("%d sensors: %.2f samples per second, %lu batches, %lu partial, %lu failed samples\n", i + 1, samples_per_second,
+               group.sequence - first_sequence, group.partial_batches, group.failed_samples);
+    }
+
+    for (uint8_t i = 0; i < number_of_sensors; i++)
+    {
+        bme280_t *dev = sensors[i];
+        bme280_set_sampling(dev, modes[i], dev->temp_sampling, dev->press_sampling, dev->hum_sampling, dev->filter, dev->duration);
+    }
+}
+
+static volatile bool async_sample_done;
+
+static void async_sample_callback(bool success, void *user_data)
+{
+    async_sample_done = true;
+}
+
+void test_sample_cpu()
+{
+    uint8_t raw[BME280_SAMPLE_LEN];
+
+    printf("test_sample_cpu blocking\n");
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_READS; count++)
+    {
+        bme280_read_raw(&bme, raw);
+    }
+    uint64_t end = time_us_64();
+    printf("CPU busy time per sample: %.2f us\n", (float)(end - start) / TEST_READS);
+
+    if (!i2c_dma_init(&bme_dma, BME280_I2C_PORT))
+    {
+        printf("No free DMA channels for the BME280\n");
+        return;
+    }
+    bme280_attach_dma(&bme, &bme_dma);
+
+    printf("test_sample_cpu DMA\n");
+    uint64_t busy_us = 0;
+    start = time_us_64();
+    for (int count = 0; count < TEST_READS; count++)
+    {
+        uint64_t queue_start = time_us_64();
+        async_sample_done = false;
+        bme280_read_raw_async(&bme, raw, async_sample_callback, NULL);
+        busy_us += time_us_64() - queue_start;
+        while (!async_sample_done)
+            tight_loop_contents();
+    }
+    end = time_us_64();
+    printf("CPU busy time per sample: %.2f us, transfer time per sample: %.2f us\n", (float)busy_us / TEST_READS, (float)(end - start) / TEST_READS);
+
+    // The sample loop reads blocking, leave bme as it was found
+    bme280_attach_dma(&bme, NULL);
 }
 
+// Publishes zero samples, core 1 can show them until the first real sample 100 ms later
+void test_publish_rate()
+{
+    printf("test_publish_rate\n");
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_PUBLISHES; count++)
+    {
+        publish_sample(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    uint64_t end = time_us_64();
+    printf("Average time per publish: %.3f us\n", (float)(end - start) / TEST_PUBLISHES);
+}
+#endif
+
 void read_sensor_and_send()
 {
     float temp, pres, alt, hum;
+    bme280_sample_t sample;
     uint64_t start_time = time_us_64();
     float elapsed_time = 0.0f;
 
     setup_bme280();
     setup_dma();
+#if RUN_BENCHMARKS
+    test_read_rate();
+    test_compensation_rate();
+    test_group_rate();
+    test_sample_cpu();
+    test_publish_rate();
+#endif
 
     while (1)
     {
         // Read data from BME280 sensor into variables
-        temp = bme280_read_temperature(&bme);
-        pres = bme280_read_pressure(&bme) / 100.0F;
-        alt = bme280_read_altitude(&bme, Sea_Level_Pressure_HPA);
-        hum = bme280_read_humidity(&bme);
+        if (!bme280_read_all(&bme, &sample, Sea_Level_Pressure_HPA))
+        {
+            sleep_ms(100);
+            continue;
+        }
+        temp = sample.temperature;
+        pres = sample.pressure / 100.0F;
+        alt = sample.altitude;
+        hum = sample.humidity;
         elapsed_time = (float)(time_us_64() - start_time) / 1000000.0f;
 
         // Print the data
         printf("Temperature = %.2f C, Pressure = %.2f hPa, Altitude = %.2f m, Humidity = %.2f %%, ", temp, pres, alt, hum);
         printf("Elapsed time: %f s, cpu ticks: %llu\n", elapsed_time, time_us_64());
 
-        // Set up DMA transfer
-        dma_channel_set_read_addr(dma_chan, &temp, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&temperature, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
+        // Hand the sample to core 1
+        publish_sample(temp, pres, alt, hum);
 
-        dma_channel_set_read_addr(dma_chan, &pres, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&pressure, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
+        // Delay for 0.1 seconds
+        sleep_ms(100);
+    }
+}
 
-        dma_channel_set_read_addr(dma_chan, &alt, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&altitude, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
+#if RUN_BENCHMARKS
+void test_display_refresh_cpu()
+{
+    // Blocking writes for comparison, the DMA transport set up in setup_i2c is put back afterwards
+    i2c_dma_t *dma = display.dma;
+    HT16K33_attachDMA(&display, NULL);
 
-        dma_channel_set_read_addr(dma_chan, &hum, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&humidity, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
+    printf("test_display_refresh_cpu blocking\n");
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_REFRESHES; count++)
+    {
+        HT16K33_updateDisplay(&display);
+    }
+    uint64_t end = time_us_64();
+    printf("CPU busy time per refresh: %.2f us\n", (float)(end - start) / TEST_REFRESHES);
 
-        // Delay for 0.1 seconds
-        sleep_ms(100);
+    HT16K33_attachDMA(&display, dma);
+
+    printf("test_display_refresh_cpu DMA\n");
+    uint64_t busy_us = 0;
+    start = time_us_64();
+    for (int count = 0; count < TEST_REFRESHES; count++)
+    {
+        uint64_t queue_start = time_us_64();
+        HT16K33_updateDisplay(&display);
+        busy_us += time_us_64() - queue_start;
+        i2c_dma_wait_idle(dma);
     }
+    end = time_us_64();
+    printf("CPU busy time per refresh: %.2f us, transfer time per refresh: %.2f us\n", (float)busy_us / TEST_REFRESHES, (float)(end - start) / TEST_REFRESHES);
 }
+#endif
 
-// function to format the data and display it
+// function to format the data and display it, one decimal while the rounded value fits in 4 digits
 void display_data(float data)
 {
-    char displayString[16];
-    int intPart = (int)data;
+    char displayString[4 * 4 + 2];
+    uint8_t decimals = 1;
+    float scaled = data * 10.0f;
+    int32_t value = (int32_t)(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
 
-    if (intPart >= 1000)
+    // 999.95 and up round to 10000 tenths, drop the decimal instead of overflowing
+    if (value >= 10000 || value <= -1000)
     {
-        snprintf(displayString, sizeof(displayString), "%4.0f", data);
+        decimals = 0;
+        value = (int32_t)(data < 0.0f ? data - 0.5f : data + 0.5f);
     }
-    else if (intPart >= 100)
+
+    if (HT16K33_formatFixed(displayString, 4, value, decimals) == 0)
     {
-        snprintf(displayString, sizeof(displayString), "%4.1f", data);
+        HT16K33_framePrint(&display, "----");
+        return;
     }
-    else if (intPart >= 10)
+    HT16K33_framePrint(&display, displayString);
+}
+
+#if RUN_BENCHMARKS
+// Formatting cost of a display value, snprintf("%4.1f") against HT16K33_formatFixed
+void test_format_rate()
+{
+    char buffer[4 * 4 + 2];
+
+    printf("test_format_rate\n");
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_FORMATS; count++)
     {
-        snprintf(displayString, sizeof(displayString), " %4.1f", data);
+        snprintf(buffer, sizeof(buffer), "%4.1f", (float)(count % 1000) / 10.0f);
     }
-    else
+    uint64_t end = time_us_64();
+    printf("snprintf: %.0f cycles per call\n", (float)(end - start) * cycles_per_us / TEST_FORMATS);
+
+    start = time_us_64();
+    for (int count = 0; count < TEST_FORMATS; count++)
     {
-        snprintf(displayString, sizeof(displayString), "  %4.1f", data);
+        HT16K33_formatFixed(buffer, 4, count % 1000, 1);
     }
-    HT16K33_print(&display, displayString);
+    end = time_us_64();
+    printf("HT16K33_formatFixed: %.0f cycles per call\n", (float)(end - start) * cycles_per_us / TEST_FORMATS);
 }
+#endif
 
 void display_task()
 {
     // Initialize Wi-Fi
     if (cyw43_arch_init())
     {
-        printf("Wi-Fi init failed");
+        printf("Wi-Fi init failed\n");
         return;
     }
 
     setup_i2c();
     setup_display();
+#if RUN_BENCHMARKS
+    test_display_refresh_cpu();
+    test_format_rate();
+#endif
 
-    bool onboarding_led_state = false;
-
-    while (1)
+    // From here on the display is only written by the refresh timer
+    if (!HT16K33_startRefresh(&display, DISPLAY_REFRESH_HZ))
     {
-        // Display temperature
-        HT16K33_print(&display, "TEMP");
-        sleep_ms(250);
-        display_data(temperature);
-        sleep_ms(750);
+        while (1)
+        {
+            printf("Display refresh not started\n");
+            sleep_ms(1000);
+        }
+    }
 
-        // Toggle onboard LED
-        onboarding_led_state = !onboarding_led_state;
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+    // The greeting runs from the refresh alarm pool, sleep on this core until it ends
+    show_greeting();
+    HT16K33_waitAnimation(&display);
 
-        // Display pressure
-        HT16K33_print(&display, "PRES");
-        sleep_ms(250);
-        display_data(pressure);
-        sleep_ms(750);
+    const char *labels[4] = {"TEMP", "PRES", "ALTD", "HUMD"};
+    bool onboarding_led_state = false;
+    sample_block_t sample;
+    uint32_t start_ms = to_ms_since_boot(get_absolute_time());
+    uint32_t last_slot = 0;
 
-        // Toggle onboard LED
-        onboarding_led_state = !onboarding_led_state;
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+    while (1)
+    {
+        // Each reading gets one second, the label for the first 250 ms and the value for the rest
+        uint32_t elapsed_ms = to_ms_since_boot(get_absolute_time()) - start_ms;
+        uint32_t slot = (elapsed_ms / 1000) % 4;
 
-        // Display altitude
-        HT16K33_print(&display, "ALTD");
-        sleep_ms(250);
-        display_data(altitude);
-        sleep_ms(750);
+        read_latest_sample(&sample);
+        float values[4] = {sample.temperature, sample.pressure, sample.altitude, sample.humidity};
 
-        // Toggle onboard LED
-        onboarding_led_state = !onboarding_led_state;
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+        if (elapsed_ms % 1000 < 250)
+            HT16K33_framePrint(&display, labels[slot]);
+        else
+            display_data(values[slot]);
 
-        // Display humidity
-        HT16K33_print(&display, "HUMD");
-        sleep_ms(250);
-        display_data(humidity);
-        sleep_ms(750);
+        // Paced by the refresh timer
+        HT16K33_submitFrame(&display);
+        HT16K33_waitFrame(&display);
 
         // Toggle onboard LED
-        onboarding_led_state = !onboarding_led_state;
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+        if (slot != last_slot)
+        {
+            onboarding_led_state = !onboarding_led_state;
+            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+            last_slot = slot;
+        }
     }
 }
 
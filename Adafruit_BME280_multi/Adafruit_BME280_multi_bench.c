@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/sem.h"
+#include "hardware/dma.h"
+#include "spsc_ring.h"
+
+// Benchmark of the inter-core hand-off strategies used by the Adafruit_BME280_multi variants.
+// Core 0 runs a synthetic producer at each rate in BENCH_RATES_HZ, core 1 runs a consumer that
+// simulates the display update. No sensor or display has to be attached.
+#define BENCH_RATES_HZ {10, 100, 1000, 10000}
+#define BENCH_DURATION_MS 2000
+#define BENCH_DISPLAY_WORK_US 250 // Time core 1 spends per sample, roughly one display refresh
+#define BENCH_RING_CAPACITY 16
+
+// Every payload field carries the sequence number so a torn read can be detected
+#define BENCH_PAYLOAD(sequence) ((float)((sequence) & 0xFFFF))
+
+typedef struct
+{
+    float temperature;
+    float pressure;
+    float altitude;
+    float humidity;
+    uint32_t timestamp_us;
+    uint32_t sequence;
+} bench_sample_t;
+
+typedef struct
+{
+    const char *name;
+    void (*init)();
+    bool (*publish)(const bench_sample_t *sample);  // core 0, false if the sample was rejected
+    bool (*receive)(bench_sample_t *sample);        // core 1, false if no new sample, never blocks
+    void (*done)();                                 // core 1, after the sample has been displayed
+} bench_strategy_t;
+
+typedef struct
+{
+    uint32_t published;
+    uint32_t rejected;
+    uint32_t received;
+    uint32_t torn;
+    uint64_t latency_sum_us;
+    uint32_t latency_max_us;
+    uint64_t core0_busy_us;
+    uint64_t core1_busy_us;
+} bench_result_t;
+
+// Strategy 1: volatile globals, as in Adafruit_BME280_multi.c before the ping-pong block
+volatile float g_temperature, g_pressure, g_altitude, g_humidity;
+volatile uint32_t g_timestamp_us, g_sequence;
+uint32_t g_last_sequence;
+
+// Strategy 2: semaphores, as in Adafruit_BME280_multi_sem.c
+semaphore_t data_ready;
+semaphore_t display_done;
+
+// Strategy 3: DMA ping-pong sample block, as in Adafruit_BME280_multi_dma.c
+bench_sample_t sample_blocks[2];
+volatile uint32_t sample_index;
+bench_sample_t sample_staging;
+uint32_t next_sample_index;
+uint32_t block_last_sequence;
+int dma_chan = -1;
+int dma_flip_chan = -1;
+
+// Strategy 4: lock-free ring, as in Adafruit_BME280_multi_ring.c
+bench_sample_t sample_ring_buffer[BENCH_RING_CAPACITY];
+spsc_ring_t sample_ring;
+
+const bench_strategy_t *current_strategy;
+volatile bool bench_running;
+volatile bool consumer_done;
+bench_result_t result;
+
+void volatile_init()
+{
+    g_sequence = 0;
+    g_last_sequence = 0;
+}
+
+bool volatile_publish(const bench_sample_t *sample)
+{
+    g_temperature = sample->temperature;
+    g_pressure = sample->pressure;
+    g_altitude = sample->altitude;
+    g_humidity = sample->humidity;
+    g_timestamp_us = sample->timestamp_us;
+    g_sequence = sample->sequence;
+    return true;
+}
+
+bool volatile_receive(bench_sample_t *sample)
+{
+    uint32_t sequence = g_sequence;
+    if (sequence == g_last_sequence)
+        return false;
+
+    sample->temperature = g_temperature;
+    sample->pressure = g_pressure;
+    sample->altitude = g_altitude;
+    sample->humidity = g_humidity;
+    sample->timestamp_us = g_timestamp_us;
+    sample->sequence = sequence;
+    g_last_sequence = sequence;
+    return true;
+}
+
+void sem_strategy_init()
+{
+    sem_init(&data_ready, 0, 1);
+    sem_init(&display_done, 1, 1);
+    volatile_init();
+}
+
+bool sem_publish(const bench_sample_t *sample)
+{
+    // Drop the sample if the display task has not completed, as the sem variant does
+    if (!sem_try_acquire(&display_done))
+        return false;
+
+    volatile_publish(sample);
+    sem_release(&data_ready);
+    return true;
+}
+
+bool sem_receive(bench_sample_t *sample)
+{
+    if (!sem_try_acquire(&data_ready))
+        return false;
+
+    return volatile_receive(sample);
+}
+
+void sem_done()
+{
+    sem_release(&display_done);
+}
+
+void block_init()
+{
+    if (dma_chan < 0)
+    {
+        dma_chan = dma_claim_unused_channel(true);
+        dma_flip_chan = dma_claim_unused_channel(true);
+    }
+
+    sample_index = 0;
+    next_sample_index = 0;
+    block_last_sequence = 0;
+    sample_blocks[0].sequence = 0;
+    sample_blocks[1].sequence = 0;
+
+    dma_channel_config c = dma_channel_get_default_config(dma_flip_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(dma_flip_chan, &c, &sample_index, &next_sample_index, 1, false);
+
+    c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_chain_to(&c, dma_flip_chan);
+    dma_channel_configure(dma_chan, &c, NULL, &sample_staging, sizeof(bench_sample_t) / 4, false);
+}
+
+bool block_publish(const bench_sample_t *sample)
+{
+    while (sample_index != next_sample_index)
+        tight_loop_contents();
+
+    sample_staging = *sample;
+    next_sample_index = sample_index ^ 1;
+    __dmb();
+    dma_channel_set_read_addr(dma_chan, &sample_staging, false);
+    dma_channel_set_write_addr(dma_chan, &sample_blocks[next_sample_index], true);
+    return true;
+}
+
+bool block_receive(bench_sample_t *sample)
+{
+    uint32_t index;
+    uint32_t sequence;
+
+    // Same retry as read_latest_sample in Adafruit_BME280_multi_dma.c
+    do
+    {
+        index = sample_index;
+        __dmb();
+        sequence = sample_blocks[index].sequence;
+        __dmb();
+        *sample = sample_blocks[index];
+        __dmb();
+    } while (sample_blocks[index].sequence != sequence || index != sample_index);
+
+    if (sample->sequence == block_last_sequence)
+        return false;
+
+    block_last_sequence = sample->sequence;
+    return true;
+}
+
+void ring_init()
+{
+    spsc_ring_init(&sample_ring, sample_ring_buffer, sizeof(bench_sample_t), BENCH_RING_CAPACITY, false);
+}
+
+bool ring_publish(const bench_sample_t *sample)
+{
+    return spsc_ring_push(&sample_ring, sample);
+}
+
+bool ring_receive(bench_sample_t *sample)
+{
+    return spsc_ring_pop(&sample_ring, sample);
+}
+
+const bench_strategy_t strategies[] = {
+    {"volatile", volatile_init, volatile_publish, volatile_receive, NULL},
+    {"semaphore", sem_strategy_init, sem_publish, sem_receive, sem_done},
+    {"dma block", block_init, block_publish, block_receive, NULL},
+    {"spsc ring", ring_init, ring_publish, ring_receive, NULL},
+};
+
+void bench_consume(bench_sample_t *sample)
+{
+    uint32_t start = time_us_32();
+    float payload = BENCH_PAYLOAD(sample->sequence);
+
+    if (sample->temperature != payload || sample->pressure != payload ||
+        sample->altitude != payload || sample->humidity != payload)
+    {
+        result.torn++;
+    }
+
+    // Simulated display update
+    busy_wait_us_32(BENCH_DISPLAY_WORK_US);
+    if (current_strategy->done)
+        current_strategy->done();
+
+    uint32_t end = time_us_32();
+    uint32_t latency_us = end - sample->timestamp_us;
+    result.latency_sum_us += latency_us;
+    if (latency_us > result.latency_max_us)
+        result.latency_max_us = latency_us;
+    result.received++;
+    result.core1_busy_us += end - start;
+}
+
+// Core 1, consumes until the producer stopped and nothing is left to receive
+void bench_consumer()
+{
+    bench_sample_t sample;
+
+    while (bench_running)
+    {
+        if (current_strategy->receive(&sample))
+            bench_consume(&sample);
+    }
+    while (current_strategy->receive(&sample))
+        bench_consume(&sample);
+
+    consumer_done = true;
+    while (1)
+        tight_loop_contents();
+}
+
+void run_benchmark(const bench_strategy_t *strategy, uint32_t rate_hz)
+{
+    uint32_t period_us = 1000000 / rate_hz;
+    bench_sample_t sample;
+
+    result = (bench_result_t){0};
+    current_strategy = strategy;
+    strategy->init();
+    bench_running = true;
+    consumer_done = false;
+
+    multicore_reset_core1();
+    multicore_launch_core1(bench_consumer);
+
+    absolute_time_t end_time = make_timeout_time_ms(BENCH_DURATION_MS);
+    absolute_time_t next_sample = get_absolute_time();
+    uint32_t sequence = 0;
+    while (!time_reached(end_time))
+    {
+        sleep_until(next_sample);
+        next_sample = delayed_by_us(next_sample, period_us);
+
+        uint64_t start = time_us_64();
+        sequence++;
+        sample.temperature = BENCH_PAYLOAD(sequence);
+        sample.pressure = BENCH_PAYLOAD(sequence);
+        sample.altitude = BENCH_PAYLOAD(sequence);
+        sample.humidity = BENCH_PAYLOAD(sequence);
+        sample.timestamp_us = time_us_32();
+        sample.sequence = sequence;
+        if (!strategy->publish(&sample))
+            result.rejected++;
+        result.published++;
+        result.core0_busy_us += time_us_64() - start;
+    }
+
+    bench_running = false;
+    while (!consumer_done)
+        tight_loop_contents();
+    multicore_reset_core1();
+
+    float duration_us = BENCH_DURATION_MS * 1000.0f;
+    printf("%-10s %6lu Hz %7lu %7lu %7lu %6lu %9.1f %8lu %6.1f%% %6.1f%%\n",
+           strategy->name, rate_hz, result.published, result.received,
+           result.published - result.received, result.torn,
+           result.received ? (float)result.latency_sum_us / result.received : 0.0f, result.latency_max_us,
+           100.0f * result.core0_busy_us / duration_us, 100.0f * result.core1_busy_us / duration_us);
+}
+
+int main()
+{
+    const uint32_t rates[] = BENCH_RATES_HZ;
+
+    stdio_init_all();
+
+    // Sleep for 3 seconds to give time to open the serial terminal
+    sleep_ms(3000);
+
+    while (1)
+    {
+        printf("Inter-core hand-off benchmark, %d ms per run, %d us display work per sample\n", BENCH_DURATION_MS, BENCH_DISPLAY_WORK_US);
+        printf("%-10s %9s %7s %7s %7s %6s %9s %8s %7s %7s\n",
+               "strategy", "rate", "sent", "shown", "dropped", "torn", "lat avg", "lat max", "core0", "core1");
+
+        for (uint32_t i = 0; i < count_of(strategies); i++)
+        {
+            for (uint32_t j = 0; j < count_of(rates); j++)
+            {
+                run_benchmark(&strategies[i], rates[j]);
+            }
+        }
+
+        printf("\n");
+        sleep_ms(10000);
+    }
+
+    return 0;
+}
@@ -23,14 +23,30 @@
 #define ONBOARD_LED_PIN CYW43_WL_GPIO_LED_PIN
 #endif
 
-// Global variables for sensor data
-volatile float temperature, pressure, altitude, humidity = 0.0;
+// Sample block handed from core 0 to core 1
+typedef struct
+{
+    float temperature;
+    float pressure;
+    float altitude;
+    float humidity;
+    uint32_t timestamp_us;
+    uint32_t sequence;
+} sample_block_t;
+
+// Ping-pong sample blocks, core 0 fills the block core 1 is not reading and a chained
+// DMA transfer flips sample_index once the whole block has landed
+sample_block_t sample_blocks[2];
+volatile uint32_t sample_index = 0;
+sample_block_t sample_staging;
+uint32_t next_sample_index = 0;
 
 bme280_t bme;
 HT16K33 display;
 
-// DMA channel
+// DMA channels, dma_chan copies the sample block and chains to dma_flip_chan
 int dma_chan;
+int dma_flip_chan;
 
 void setup_i2c();
 void setup_bme280();
@@ -38,6 +54,8 @@ void setup_display();
 void read_and_send_data();
 void core1_display_task();
 void setup_dma();
+void publish_sample(float temp, float pres, float alt, float hum);
+void read_latest_sample(sample_block_t *sample);
 
 void setup_i2c()
 {
@@ -99,16 +117,67 @@ void setup_display()
 void setup_dma()
 {
     dma_chan = dma_claim_unused_channel(true);
-    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    dma_flip_chan = dma_claim_unused_channel(true);
+
+    // Writes next_sample_index to sample_index, triggered by the end of the sample block copy
+    dma_channel_config c = dma_channel_get_default_config(dma_flip_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(dma_flip_chan, &c, &sample_index, &next_sample_index, 1, false);
+
+    c = dma_channel_get_default_config(dma_chan);
     channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
     channel_config_set_read_increment(&c, true);
     channel_config_set_write_increment(&c, true);
-    dma_channel_configure(dma_chan, &c, NULL, NULL, 0, false);
+    channel_config_set_chain_to(&c, dma_flip_chan);
+    dma_channel_configure(dma_chan, &c, NULL, &sample_staging, sizeof(sample_block_t) / 4, false);
+}
+
+void publish_sample(float temp, float pres, float alt, float hum)
+{
+    // The previous block must have landed and the index flipped before the staging block is reused
+    while (sample_index != next_sample_index)
+        tight_loop_contents();
+
+    sample_staging.temperature = temp;
+    sample_staging.pressure = pres;
+    sample_staging.altitude = alt;
+    sample_staging.humidity = hum;
+    sample_staging.timestamp_us = time_us_32();
+    sample_staging.sequence++;
+
+    next_sample_index = sample_index ^ 1;
+    // The staging stores must be complete before the DMA reads the block
+    __dmb();
+    dma_channel_set_read_addr(dma_chan, &sample_staging, false);
+    dma_channel_set_write_addr(dma_chan, &sample_blocks[next_sample_index], true);
+}
+
+// Called from core 1. The block at sample_index is not written while it is current, but if core 0
+// publishes twice during the copy the DMA rewrites it. The block's sequence, the last word the DMA
+// writes, is read before the copy and checked after it, so a block that was rewritten, even with
+// sample_index back at the same block, or that is still being rewritten makes the copy retry.
+void read_latest_sample(sample_block_t *sample)
+{
+    uint32_t index;
+    uint32_t sequence;
+
+    do
+    {
+        index = sample_index;
+        __dmb();
+        sequence = sample_blocks[index].sequence;
+        __dmb();
+        *sample = sample_blocks[index];
+        __dmb();
+    } while (sample_blocks[index].sequence != sequence || index != sample_index);
 }
 
 void read_sensor_and_send()
 {
     float temp, pres, alt, hum;
+    bme280_sample_t sample;
     uint64_t start_time = time_us_64();
     float elapsed_time = 0.0f;
 
@@ -118,36 +187,23 @@ void read_sensor_and_send()
     while (1)
     {
         // Read data from BME280 sensor into variables
-        temp = bme280_read_temperature(&bme);
-        pres = bme280_read_pressure(&bme) / 100.0F;
-        alt = bme280_read_altitude(&bme, Sea_Level_Pressure_HPA);
-        hum = bme280_read_humidity(&bme);
+        if (!bme280_read_all(&bme, &sample, Sea_Level_Pressure_HPA))
+        {
+            sleep_ms(100);
+            continue;
+        }
+        temp = sample.temperature;
+        pres = sample.pressure / 100.0F;
+        alt = sample.altitude;
+        hum = sample.humidity;
         elapsed_time = (float)(time_us_64() - start_time) / 1000000.0f;
 
         // Print the data
         printf("Temperature = %.2f °C, Pressure = %.2f hPa, Altitude = %.2f m, Humidity = %.2f %%", temp, pres, alt, hum);
         printf("elapsed time: %f s, cpu ticks: %llu\n", elapsed_time, time_us_64());
 
-        // Set up DMA transfer
-        dma_channel_set_read_addr(dma_chan, &temp, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&temperature, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
-
-        dma_channel_set_read_addr(dma_chan, &pres, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&pressure, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
-
-        dma_channel_set_read_addr(dma_chan, &alt, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&altitude, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
-
-        dma_channel_set_read_addr(dma_chan, &hum, false);
-        dma_channel_set_write_addr(dma_chan, (volatile void *)&humidity, false);
-        dma_channel_set_trans_count(dma_chan, 1, true);
-        dma_channel_wait_for_finish_blocking(dma_chan);
+        // Hand the sample to core 1
+        publish_sample(temp, pres, alt, hum);
 
         // Delay for 0.1 seconds
         sleep_ms(100);
@@ -192,13 +248,16 @@ void display_task()
     setup_display();
 
     bool onboarding_led_state = false;
+    sample_block_t sample;
 
     while (1)
     {
+        read_latest_sample(&sample);
+
         // Display temperature
         HT16K33_print(&display, "TEMP");
         sleep_ms(250);
-        display_data(temperature);
+        display_data(sample.temperature);
         sleep_ms(750);
 
         // Toggle onboard LED
@@ -208,7 +267,7 @@ void display_task()
         // Display pressure
         HT16K33_print(&display, "PRES");
         sleep_ms(250);
-        display_data(pressure);
+        display_data(sample.pressure);
         sleep_ms(750);
 
         // Toggle onboard LED
@@ -218,7 +277,7 @@ void display_task()
         // Display altitude
         HT16K33_print(&display, "ALTD");
         sleep_ms(250);
-        display_data(altitude);
+        display_data(sample.altitude);
         sleep_ms(750);
 
         // Toggle onboard LED
@@ -228,7 +287,7 @@ void display_task()
         // Display humidity
         HT16K33_print(&display, "HUMD");
         sleep_ms(250);
-        display_data(humidity);
+        display_data(sample.humidity);
         sleep_ms(750);
 
         // Toggle onboard LED
@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "pico/cyw43_arch.h"
+#include "SparkFun_Alphanumeric_Display.h"
+#include "Adafruit_BME280.h"
+#include "spsc_ring.h"
+
+#define SparkFun_I2C_PORT i2c1
+#define SparkFun_I2C_SDA_PIN 14
+#define SparkFun_I2C_SCL_PIN 15
+#define BME280_I2C_PORT i2c0
+#define BME280_I2C_SDA_PIN 16
+#define BME280_I2C_SCL_PIN 17
+#define Sea_Level_Pressure_HPA (1013.25)
+#define SAMPLE_RING_CAPACITY 16
+#define TEST_RING_SAMPLES 100000
+#define DROP_REPORT_MS 10000 // Interval of the dropped sample report on core 0
+
+// Define onboard LED
+#ifndef PICO_DEFAULT_LED_PIN
+#define ONBOARD_LED_PIN CYW43_WL_GPIO_LED_PIN
+#endif
+
+typedef struct
+{
+    float temperature;
+    float pressure;
+    float altitude;
+    float humidity;
+    uint32_t timestamp_us;
+} ring_sample_t;
+
+// Samples passed from core 0 to core 1
+ring_sample_t sample_ring_buffer[SAMPLE_RING_CAPACITY];
+spsc_ring_t sample_ring;
+
+// Results of test_ring_rate, written by core 1
+volatile bool ring_test_done;
+volatile uint32_t ring_test_received;
+volatile uint32_t ring_test_batches;
+volatile uint64_t ring_test_latency_sum_us;
+volatile uint32_t ring_test_latency_max_us;
+
+bme280_t bme;
+HT16K33 display;
+
+void setup_i2c();
+void setup_bme280();
+void setup_display();
+void read_and_send_data();
+void core1_display_task();
+void take_latest_sample(ring_sample_t *latest);
+void test_ring_rate();
+
+void setup_i2c()
+{
+    // Initialize I2C port at 100 kHz
+    uint baudrate = i2c_init(SparkFun_I2C_PORT, 400 * 1000);
+    gpio_set_function(SparkFun_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(SparkFun_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(SparkFun_I2C_SDA_PIN);
+    gpio_pull_up(SparkFun_I2C_SCL_PIN);
+
+    // Initialize the display
+    if (!HT16K33_begin(&display, 0x70, DEFAULT_NOTHING_ATTACHED, DEFAULT_NOTHING_ATTACHED, DEFAULT_NOTHING_ATTACHED, SparkFun_I2C_PORT))
+    {
+        while (1)
+        {
+            printf("Failed to initialize display\n");
+            sleep_ms(1000);
+        }
+    }
+    printf("Display I2C initialized with baudrate: %d\n", baudrate);
+}
+
+void setup_bme280()
+{
+    // Initialize I2C port at 100 kHz
+    uint baudrate = i2c_init(BME280_I2C_PORT, 100 * 1000);
+    gpio_set_function(BME280_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(BME280_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(BME280_I2C_SDA_PIN);
+    gpio_pull_up(BME280_I2C_SCL_PIN);
+
+    // Initialize BME280 sensor
+    if (!bme280_init(&bme, BME280_I2C_PORT, BME280_ADDRESS))
+    {
+        while (1)
+        {
+            printf("Could not find a valid BME280 sensor, check wiring!\n");
+            sleep_ms(1000);
+        }
+    }
+    printf("BME280 I2C initialized with baudrate: %d\n", baudrate);
+}
+
+void setup_display()
+{
+    HT16K33_clear(&display);
+    sleep_ms(250);
+    HT16K33_setBlinkRate(&display, 0);
+    sleep_ms(250);
+    HT16K33_print(&display, "-HI-");
+    sleep_ms(250);
+    HT16K33_setBrightness(&display, 15);
+    sleep_ms(250);
+    HT16K33_setBrightness(&display, 0);
+    sleep_ms(250);
+    HT16K33_clear(&display);
+}
+
+void read_sensor_and_send()
+{
+    float temp, pres, alt, hum;
+    bme280_sample_t sample;
+    uint32_t reported_dropped = 0;
+    uint32_t report_ms = to_ms_since_boot(get_absolute_time());
+
+    setup_bme280();
+
+    while (1)
+    {
+        // Read data from BME280 sensor
+        if (!bme280_read_all(&bme, &sample, Sea_Level_Pressure_HPA))
+        {
+            sleep_ms(100);
+            continue;
+        }
+        temp = sample.temperature;
+        pres = sample.pressure / 100.0F;
+        alt = sample.altitude;
+        hum = sample.humidity;
+
+        // Print the data
+        printf("Temperature = %.2f °C, Pressure = %.2f hPa, Altitude = %.2f m, Humidity = %.2f %%\n", temp, pres, alt, hum);
+
+        // Hand the sample to core 1, never blocks. Drops are only reported now and then, core 1
+        // drains the ring often enough that there are none in normal operation.
+        ring_sample_t ring_sample = {temp, pres, alt, hum, time_us_32()};
+        spsc_ring_push(&sample_ring, &ring_sample);
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+        if (now_ms - report_ms >= DROP_REPORT_MS)
+        {
+            if (sample_ring.dropped != reported_dropped)
+            {
+                printf("Sample ring full, %lu samples dropped\n", sample_ring.dropped - reported_dropped);
+                reported_dropped = sample_ring.dropped;
+            }
+            report_ms = now_ms;
+        }
+
+        // Delay for 0.1 seconds
+        sleep_ms(100);
+    }
+}
+
+// Empty the ring and keep the newest sample, the display only shows the latest value. Called once
+// per displayed value, every second, while core 0 pushes 10 samples per second into 16 slots.
+void take_latest_sample(ring_sample_t *latest)
+{
+    ring_sample_t batch[SAMPLE_RING_CAPACITY];
+    uint32_t count;
+
+    while ((count = spsc_ring_pop_batch(&sample_ring, batch, SAMPLE_RING_CAPACITY)) > 0)
+        *latest = batch[count - 1];
+}
+
+// function to format the data and display it
+void display_data(float data)
+{
+    char displayString[16];
+    int intPart = (int)data;
+
+    if (intPart >= 1000)
+    {
+        snprintf(displayString, sizeof(displayString), "%4.0f", data);
+    }
+    else if (intPart >= 100)
+    {
+        snprintf(displayString, sizeof(displayString), "%4.1f", data);
+    }
+    else if (intPart >= 10)
+    {
+        snprintf(displayString, sizeof(displayString), " %4.1f", data);
+    }
+    else
+    {
+        snprintf(displayString, sizeof(displayString), "  %4.1f", data);
+    }
+    HT16K33_print(&display, displayString);
+}
+
+void display_task()
+{
+    // Initialize Wi-Fi
+    if (cyw43_arch_init())
+    {
+        printf("Wi-Fi init failed");
+        return;
+    }
+
+    setup_i2c();
+    setup_display();
+
+    bool onboarding_led_state = false;
+    ring_sample_t latest;
+
+    // Wait for the first sample, afterwards every value shown is the newest one in the ring
+    while (!spsc_ring_wait(&sample_ring, 1000000))
+        ;
+
+    while (1)
+    {
+        // Display temperature
+        HT16K33_print(&display, "TEMP");
+        sleep_ms(250);
+        take_latest_sample(&latest);
+        display_data(latest.temperature);
+        sleep_ms(750);
+
+        // Toggle onboard LED
+        onboarding_led_state = !onboarding_led_state;
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+
+        // Display pressure
+        HT16K33_print(&display, "PRES");
+        sleep_ms(250);
+        take_latest_sample(&latest);
+        display_data(latest.pressure);
+        sleep_ms(750);
+
+        // Toggle onboard LED
+        onboarding_led_state = !onboarding_led_state;
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+
+        // Display altitude
+        HT16K33_print(&display, "ALTD");
+        sleep_ms(250);
+        take_latest_sample(&latest);
+        display_data(latest.altitude);
+        sleep_ms(750);
+
+        // Toggle onboard LED
+        onboarding_led_state = !onboarding_led_state;
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+
+        // Display humidity
+        HT16K33_print(&display, "HUMD");
+        sleep_ms(250);
+        take_latest_sample(&latest);
+        display_data(latest.humidity);
+        sleep_ms(750);
+
+        // Toggle onboard LED
+        onboarding_led_state = !onboarding_led_state;
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, onboarding_led_state);
+    }
+}
+
+void ring_test_consumer()
+{
+    ring_sample_t batch[SAMPLE_RING_CAPACITY];
+    uint32_t received = 0;
+    uint32_t batches = 0;
+    uint64_t latency_sum_us = 0;
+    uint32_t latency_max_us = 0;
+
+    while (received + sample_ring.dropped < TEST_RING_SAMPLES)
+    {
+        if (!spsc_ring_wait(&sample_ring, 1000))
+            continue;
+
+        uint32_t count = spsc_ring_pop_batch(&sample_ring, batch, SAMPLE_RING_CAPACITY);
+        uint32_t now = time_us_32();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t latency_us = now - batch[i].timestamp_us;
+            latency_sum_us += latency_us;
+            if (latency_us > latency_max_us)
+                latency_max_us = latency_us;
+        }
+        received += count;
+        batches++;
+    }
+
+    ring_test_received = received;
+    ring_test_batches = batches;
+    ring_test_latency_sum_us = latency_sum_us;
+    ring_test_latency_max_us = latency_max_us;
+    ring_test_done = true;
+
+    while (1)
+        tight_loop_contents();
+}
+
+// Push TEST_RING_SAMPLES as fast as possible from core 0 while core 1 drains in batches
+void test_ring_rate()
+{
+    ring_sample_t ring_sample = {0};
+
+    printf("test_ring_rate\n");
+    ring_test_done = false;
+    multicore_reset_core1();
+    multicore_launch_core1(ring_test_consumer);
+
+    uint64_t start = time_us_64();
+    for (uint32_t count = 0; count < TEST_RING_SAMPLES; count++)
+    {
+        ring_sample.timestamp_us = time_us_32();
+        spsc_ring_push(&sample_ring, &ring_sample);
+    }
+    while (!ring_test_done)
+        tight_loop_contents();
+    uint64_t end = time_us_64();
+
+    float elapsed_time_s = (float)(end - start) / 1000000.0f;
+    printf("Throughput: %.0f samples per second, %lu received, %lu dropped, %lu batches\n", ring_test_received / elapsed_time_s, ring_test_received, sample_ring.dropped, ring_test_batches);
+    printf("Latency: %.2f us average, %lu us max\n", (float)ring_test_latency_sum_us / ring_test_received, ring_test_latency_max_us);
+
+    spsc_ring_init(&sample_ring, sample_ring_buffer, sizeof(ring_sample_t), SAMPLE_RING_CAPACITY, true);
+}
+
+int main()
+{
+    stdio_init_all();
+
+    spsc_ring_init(&sample_ring, sample_ring_buffer, sizeof(ring_sample_t), SAMPLE_RING_CAPACITY, true);
+
+    // Sleep for 3 seconds to give time to open the serial terminal
+    sleep_ms(3000);
+
+    test_ring_rate();
+
+    multicore_reset_core1();
+    multicore_launch_core1(display_task);
+
+    read_sensor_and_send();
+
+    return 0;
+}
\ No newline at end of file
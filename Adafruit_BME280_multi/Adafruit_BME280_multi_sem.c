@@ -98,16 +98,22 @@ void setup_display()
 void read_sensor_and_send()
 {
     float temp, pres, alt, hum;
+    bme280_sample_t sample;
 
     setup_bme280();
 
     while (1)
     {
         // Read data from BME280 sensor
-        temp = bme280_read_temperature(&bme);
-        pres = bme280_read_pressure(&bme) / 100.0F;
-        alt = bme280_read_altitude(&bme, Sea_Level_Pressure_HPA);
-        hum = bme280_read_humidity(&bme);
+        if (!bme280_read_all(&bme, &sample, Sea_Level_Pressure_HPA))
+        {
+            sleep_ms(100);
+            continue;
+        }
+        temp = sample.temperature;
+        pres = sample.pressure / 100.0F;
+        alt = sample.altitude;
+        hum = sample.humidity;
 
         // Print the data
         printf("Temperature = %.2f °C, Pressure = %.2f hPa, Altitude = %.2f m, Humidity = %.2f %%\n", temp, pres, alt, hum);
@@ -0,0 +1,172 @@
+#include <string.h>
+#include "BME280_group.h"
+
+static int64_t startAlarm(alarm_id_t id, void *user_data);
+static void startSlot(bme280_group_slot_t *slot);
+static void sampleCallback(bme280_t *dev, const bme280_sample_fixed_t *sample, void *user_data);
+
+void bme280_group_init(bme280_group_t *group, uint32_t seaLevelPa)
+{
+  memset(group, 0, sizeof(*group));
+  group->sea_level_pa = seaLevelPa;
+  critical_section_init(&group->lock);
+}
+
+// Add an initialised sensor, it is switched to forced mode keeping its oversampling and filter settings
+bool bme280_group_add(bme280_group_t *group, bme280_t *dev)
+{
+  if (group->running || group->number_of_devices >= BME280_GROUP_MAX_DEVICES)
+    return false;
+
+  bme280_group_slot_t *slot = &group->slots[group->number_of_devices];
+  slot->group = group;
+  slot->dev = dev;
+  slot->index = group->number_of_devices;
+  group->number_of_devices++;
+
+  bme280_set_sampling(dev, MODE_FORCED, dev->temp_sampling, dev->press_sampling, dev->hum_sampling, dev->filter, dev->duration);
+  return true;
+}
+
+// Start free running conversions on all sensors, start times are spread evenly over the longest
+// conversion time so the readouts of the sensors do not pile up on the bus.
+// All bus traffic of the group runs from the alarm IRQ of the calling core.
+bool bme280_group_start(bme280_group_t *group)
+{
+  if (group->running || group->number_of_devices == 0)
+    return false;
+
+  uint32_t longest_us = 0;
+  for (uint8_t i = 0; i < group->number_of_devices; i++)
+  {
+    uint32_t time_us = bme280_measurement_time_us(group->slots[i].dev);
+    if (time_us > longest_us)
+      longest_us = time_us;
+  }
+
+  memset(&group->pending_batch, 0, sizeof(group->pending_batch));
+  group->batch_ready = false;
+  group->samples = 0;
+  group->failed_samples = 0;
+  group->partial_batches = 0;
+  group->batch_timeout_us = BME280_GROUP_BATCH_TIMEOUT_ROUNDS * longest_us;
+  group->start_time_us = time_us_64();
+  group->running = true;
+
+  uint32_t offset_us = longest_us / group->number_of_devices;
+  for (uint8_t i = 0; i < group->number_of_devices; i++)
+  {
+    group->slots[i].start_alarm_id = add_alarm_in_us(1 + i * offset_us, startAlarm, &group->slots[i], true);
+  }
+  return true;
+}
+
+void bme280_group_stop(bme280_group_t *group)
+{
+  group->running = false;
+  for (uint8_t i = 0; i < group->number_of_devices; i++)
+  {
+    cancel_alarm(group->slots[i].start_alarm_id);
+    bme280_cancel_forced_measurement(group->slots[i].dev);
+  }
+}
+
+// Copy the latest complete batch, returns false if no new batch was published since the last call
+bool bme280_group_read_batch(bme280_group_t *group, bme280_batch_t *batch)
+{
+  bool ready;
+
+  critical_section_enter_blocking(&group->lock);
+  ready = group->batch_ready;
+  if (ready)
+  {
+    memcpy(batch, &group->ready_batch, sizeof(*batch));
+    group->batch_ready = false;
+  }
+  critical_section_exit(&group->lock);
+
+  return ready;
+}
+
+float bme280_group_samples_per_second(bme280_group_t *group)
+{
+  uint64_t elapsed_us = time_us_64() - group->start_time_us;
+  if (elapsed_us == 0)
+    return 0;
+  return group->samples * 1000000.0f / elapsed_us;
+}
+
+static int64_t startAlarm(alarm_id_t id, void *user_data)
+{
+  bme280_group_slot_t *slot = (bme280_group_slot_t *)user_data;
+
+  if (slot->group->running)
+    startSlot(slot);
+  return 0;
+}
+
+// Start the next conversion of a slot. If the alarm pool or the DMA queue is full the slot tries
+// again later instead of dropping out of the group for the rest of the run.
+static void startSlot(bme280_group_slot_t *slot)
+{
+  bme280_group_t *group = slot->group;
+
+  if (bme280_start_forced_measurement(slot->dev, group->sea_level_pa, sampleCallback, slot))
+    return;
+
+  // A conversion of this slot already runs, its callback keeps the slot going
+  if (slot->dev->measurement_pending && slot->dev->sample_callback == sampleCallback)
+    return;
+
+  group->failed_samples++;
+  slot->start_alarm_id = add_alarm_in_us(BME280_GROUP_RETRY_US, startAlarm, slot, true);
+}
+
+static void sampleCallback(bme280_t *dev, const bme280_sample_fixed_t *sample, void *user_data)
+{
+  bme280_group_slot_t *slot = (bme280_group_slot_t *)user_data;
+  bme280_group_t *group = slot->group;
+  bme280_batch_t *batch = &group->pending_batch;
+
+  if (!group->running)
+    return;
+
+  // Start the next conversion right away, the sensor converts while the other sensors use the bus
+  startSlot(slot);
+
+  uint64_t now_us = time_us_64();
+  if (sample == NULL)
+  {
+    group->failed_samples++;
+  }
+  else
+  {
+    if (batch->valid_mask == 0)
+      group->batch_start_us = now_us;
+
+    group->samples++;
+    batch->samples[slot->index] = *sample;
+    batch->sample_time_us[slot->index] = now_us;
+    batch->valid_mask |= 1 << slot->index;
+  }
+
+  // Publish once every sensor delivered a sample since the last batch. A sensor that keeps failing
+  // must not hold back the others, so after the timeout the batch goes out with its bit clear.
+  bool complete = batch->valid_mask == (1 << group->number_of_devices) - 1;
+  if (complete || (batch->valid_mask && now_us - group->batch_start_us >= group->batch_timeout_us))
+  {
+    if (!complete)
+      group->partial_batches++;
+
+    batch->timestamp_us = now_us;
+    batch->number_of_devices = group->number_of_devices;
+    batch->sequence = ++group->sequence;
+
+    critical_section_enter_blocking(&group->lock);
+    memcpy(&group->ready_batch, batch, sizeof(*batch));
+    group->batch_ready = true;
+    critical_section_exit(&group->lock);
+
+    batch->valid_mask = 0;
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef BME280_GROUP_H
+#define BME280_GROUP_H
+
+#include "pico/stdlib.h"
+#include "pico/critical_section.h"
+#include "Adafruit_BME280.h"
+
+#define BME280_GROUP_MAX_DEVICES 4 // 0x76 and 0x77 on both I2C controllers
+#define BME280_GROUP_BATCH_TIMEOUT_ROUNDS 3 // Publish an incomplete batch after this many conversion times
+#define BME280_GROUP_RETRY_US 1000 // Delay before a conversion that failed to start is tried again
+
+typedef struct
+{
+  uint64_t timestamp_us;                                  // time the batch was completed
+  uint32_t sequence;                                      // incremented for every published batch
+  uint8_t number_of_devices;                              // number of valid entries in samples
+  uint8_t valid_mask;                                     // bit i is set if samples[i] holds a new sample
+  uint64_t sample_time_us[BME280_GROUP_MAX_DEVICES];      // time each sample was read
+  bme280_sample_fixed_t samples[BME280_GROUP_MAX_DEVICES];
+} bme280_batch_t;
+
+typedef struct bme280_group bme280_group_t;
+
+typedef struct
+{
+  bme280_group_t *group;
+  bme280_t *dev;
+  uint8_t index;
+  alarm_id_t start_alarm_id;
+} bme280_group_slot_t;
+
+struct bme280_group
+{
+  bme280_group_slot_t slots[BME280_GROUP_MAX_DEVICES];
+  uint8_t number_of_devices;
+  uint32_t sea_level_pa;
+  volatile bool running;
+  critical_section_t lock;
+  bme280_batch_t pending_batch;
+  bme280_batch_t ready_batch;
+  volatile bool batch_ready;
+  uint32_t sequence;
+  uint32_t samples;
+  uint32_t failed_samples;   // conversions that failed to start or to complete
+  uint32_t partial_batches; // batches published by the timeout with some valid_mask bits clear
+  uint64_t start_time_us;
+  uint64_t batch_start_us;   // time of the first sample in pending_batch
+  uint32_t batch_timeout_us;
+};
+
+void bme280_group_init(bme280_group_t *group, uint32_t seaLevelPa);
+bool bme280_group_add(bme280_group_t *group, bme280_t *dev);
+bool bme280_group_start(bme280_group_t *group);
+void bme280_group_stop(bme280_group_t *group);
+bool bme280_group_read_batch(bme280_group_t *group, bme280_batch_t *batch);
+float bme280_group_samples_per_second(bme280_group_t *group);
+
+#endif // BME280_GROUP_H
@@ -1,13 +1,30 @@
 #ifndef __SPARKFUN_ALPHANUMERIC_DISPLAY_H__
 #define __SPARKFUN_ALPHANUMERIC_DISPLAY_H__
 
+#include "pico/time.h"
+#include "pico/critical_section.h"
 #include "hardware/i2c.h"
+#include "i2c_dma.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define DEFAULT_ADDRESS 0x70 // Default I2C address when A0, A1 are floating
 #define DEFAULT_NOTHING_ATTACHED 0xFF
+#define HT16K33_REPROBE_INTERVAL_MS 1000 // Minimum time between probes of a display marked as disconnected
+#define HT16K33_GLYPH_COUNT 96
+#define HT16K33_RAM_BLOCK 17 // Each display has a spare register byte followed by its 16 bytes of display RAM
+#define HT16K33_RAM(ram, displayIndex) ((ram) + (displayIndex) * HT16K33_RAM_BLOCK + 1) // RAM of display 0 to 3
+#define HT16K33_GLYPH_DEFINED 0x8000 // Set in char_overrides for characters redefined with HT16K33_defineChar
+#define HT16K33_SCROLL_MAX_LENGTH 128 // Longer scroll texts are truncated
+#define HT16K33_MAX_KEYFRAMES 8
+#define HT16K33_ANIMATION_TICK_MS 10
+#define HT16K33_ALL_DIGITS 0xFF
+#define HT16K33_DIGIT_LEVELS 16 // Digit level for full on, lower levels are dithered by the refresh
+#define HT16K33_KEY_RAM 0x40              // 6 bytes, 13 rows for each of K1, K2 and K3
+#define HT16K33_KEY_QUEUE_LEN 16
+#define HT16K33_KEY_DEBOUNCE_READS 2 // Identical key RAM reads before a change is reported
+#define HT16K33_KEY_REREAD_MS 40     // INT stays quiet once keys are released, re-read after this time
 
 #define SEG_A 0x0001
 #define SEG_B 0x0002
@@ -55,14 +72,39 @@ typedef enum
     ALPHA_CMD_SYSTEM_SETUP = 0b00100000,
     ALPHA_CMD_DISPLAY_SETUP = 0b10000000,
     ALPHA_CMD_DIMMING_SETUP = 0b11100000,
+    ALPHA_CMD_ROWINT_SETUP = 0b10100000,
 } alpha_command_t;
 
-struct CharDef
+typedef struct
+{
+    void *display;
+    uint8_t display_number;
+} HT16K33_dma_context;
+
+typedef enum
+{
+    HT16K33_ANIM_BRIGHTNESS,  // Ramp the dimming duty from start to end (0 to 15)
+    HT16K33_ANIM_BLINK,       // Toggle the displays off and on every period_ms, ends on
+    HT16K33_ANIM_DIGIT_LEVEL, // Ramp the level of digit from start to end (0 to HT16K33_DIGIT_LEVELS)
+} HT16K33_animation_type;
+
+typedef struct
+{
+    HT16K33_animation_type type;
+    uint8_t digit; // HT16K33_ANIM_DIGIT_LEVEL only, HT16K33_ALL_DIGITS for every digit
+    uint8_t start;
+    uint8_t end;
+    uint16_t period_ms;
+    uint32_t duration_ms;
+} HT16K33_keyframe;
+
+typedef struct
 {
-    uint8_t position;
-    int16_t segments;
-    struct CharDef *next;
-};
+    uint8_t display_number;
+    uint8_t key; // K line * 13 + row, 0 to 38
+    bool pressed;
+    uint32_t time_ms;
+} HT16K33_key_event;
 
 typedef struct
 {
@@ -77,15 +119,66 @@ typedef struct
     bool decimal_on_off;
     bool colon_on_off;
     uint8_t blink_rate;
-    uint8_t display_ram[16 * 4];
+    uint8_t display_ram[HT16K33_RAM_BLOCK * 4];
+    uint8_t chip_ram[16 * 4]; // What each display holds, only bytes that differ are sent
+    bool chip_ram_valid[4];
     char display_content[4 * 4 + 1];
-    struct CharDef *char_def_list;
+    uint16_t char_overrides[HT16K33_GLYPH_COUNT];
+    bool display_connected[4];
+    absolute_time_t next_probe_time[4];
+    uint32_t bus_transactions;
+    uint32_t bus_bytes; // Register and data bytes moved over the bus, not counting address bytes
+    i2c_dma_t *dma;
+    HT16K33_dma_context dma_context[4];
+    uint8_t frame_buffers[2][HT16K33_RAM_BLOCK * 4]; // Back buffer rendered by the application, front buffer pushed by the refresh timer
+    uint8_t back_frame;
+    volatile bool frame_pending;
+    volatile uint32_t frame_sequence;       // Last submitted frame
+    volatile uint32_t frame_shown_sequence; // Last frame queued to the displays
+    volatile uint32_t frames_dropped;       // Frames replaced before they were shown
+    critical_section_t frame_lock;
+    alarm_pool_t *refresh_pool;
+    repeating_timer_t refresh_timer;
+    uint16_t scroll_glyphs[HT16K33_SCROLL_MAX_LENGTH];
+    uint16_t scroll_length;
+    uint16_t scroll_position;
+    bool scrolling;
+    repeating_timer_t scroll_timer;
+    HT16K33_keyframe animation[HT16K33_MAX_KEYFRAMES];
+    uint8_t animation_length;
+    uint8_t animation_index;
+    bool animation_loop;
+    volatile bool animating;
+    absolute_time_t keyframe_start;
+    uint8_t animation_duty;
+    bool animation_on;
+    repeating_timer_t animation_timer;
+    uint8_t digit_level[16];
+    uint8_t digit_dither[16];
+    bool dithering;
+    bool dither_flush; // Dithering just ended, push the plain RAM once more
+    bool keyscan_enabled;
+    uint key_int_gpio;
+    volatile bool key_irq_pending;
+    volatile bool key_read_busy[4];
+    uint8_t key_ram[4][6];
+    uint16_t key_state[4][3];     // Debounced, reported to the application
+    uint16_t key_candidate[4][3]; // Last read
+    uint8_t key_candidate_reads;
+    absolute_time_t key_next_read;
+    HT16K33_key_event key_events[HT16K33_KEY_QUEUE_LEN];
+    uint8_t key_head;
+    uint8_t key_tail;
+    uint32_t key_events_dropped;
 } HT16K33;
 
 bool HT16K33_begin(HT16K33 *display, uint8_t addressDisplayOne, uint8_t addressDisplayTwo, uint8_t addressDisplayThree, uint8_t addressDisplayFour, i2c_inst_t *i2c_port);
 bool HT16K33_isConnected(HT16K33 *display, uint8_t displayNumber);
 bool HT16K33_initialize(HT16K33 *display);
 uint8_t HT16K33_lookUpDisplayAddress(HT16K33 *display, uint8_t displayNumber);
+uint8_t HT16K33_lookUpDisplayNumber(HT16K33 *display, uint8_t address);
+bool HT16K33_checkLink(HT16K33 *display, uint8_t displayNumber);
+void HT16K33_attachDMA(HT16K33 *display, i2c_dma_t *dma);
 
 bool HT16K33_clear(HT16K33 *display);
 bool HT16K33_setBrightness(HT16K33 *display, uint8_t duty);
@@ -126,6 +219,29 @@ bool HT16K33_setColonOnOff(HT16K33 *display, uint8_t displayNumber, bool turnOnC
 bool HT16K33_shiftRight(HT16K33 *display, uint8_t shiftAmt);
 bool HT16K33_shiftLeft(HT16K33 *display, uint8_t shiftAmt);
 bool HT16K33_print(HT16K33 *display, const char *str);
+bool HT16K33_printN(HT16K33 *display, const char *str, size_t length);
+bool HT16K33_printFixed(HT16K33 *display, int32_t value, uint8_t decimals);
+uint8_t HT16K33_formatFixed(char *buffer, uint8_t width, int32_t value, uint8_t decimals);
+
+bool HT16K33_startRefresh(HT16K33 *display, uint32_t refreshHz);
+void HT16K33_stopRefresh(HT16K33 *display);
+uint8_t *HT16K33_frameBuffer(HT16K33 *display);
+bool HT16K33_framePrint(HT16K33 *display, const char *str);
+uint32_t HT16K33_submitFrame(HT16K33 *display);
+void HT16K33_waitFrame(HT16K33 *display);
+bool HT16K33_startScroll(HT16K33 *display, const char *text, uint32_t stepMs);
+void HT16K33_stopScroll(HT16K33 *display);
+
+bool HT16K33_startAnimation(HT16K33 *display, const HT16K33_keyframe *keyframes, uint8_t count, bool loop);
+void HT16K33_stopAnimation(HT16K33 *display);
+bool HT16K33_animationRunning(HT16K33 *display);
+void HT16K33_waitAnimation(HT16K33 *display);
+void HT16K33_setDigitLevel(HT16K33 *display, uint8_t digit, uint8_t level);
+
+bool HT16K33_enableKeyscan(HT16K33 *display, uint intGpio);
+bool HT16K33_disableKeyscan(HT16K33 *display);
+bool HT16K33_serviceKeys(HT16K33 *display);
+bool HT16K33_getKeyEvent(HT16K33 *display, HT16K33_key_event *event);
 
 bool HT16K33_readRAM(HT16K33 *display, uint8_t address, uint8_t reg, uint8_t *buff, uint8_t buffSize);
 bool HT16K33_writeRAM(HT16K33 *display, uint8_t address, uint8_t reg, uint8_t *buff, uint8_t buffSize);
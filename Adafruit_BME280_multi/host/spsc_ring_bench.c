@@ -0,0 +1,165 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "spsc_ring.h"
+
+// Host version of the spsc ring benchmark, a producer and a consumer thread stand in for the two
+// cores. The producer pushes at each rate in BENCH_RATES_HZ, 0 meaning as fast as it can, the
+// consumer drains in batches and checks that every sample arrives whole and in order. Every run is
+// done with the consumer spinning and with it sleeping until the producer signals. The exit status
+// is nonzero if any check failed.
+#define BENCH_RATES_HZ {0, 1000000, 100000}
+#define BENCH_SAMPLES 1000000
+#define BENCH_PACED_MS 1000 // Length of the paced runs
+#define BENCH_RING_CAPACITY 16
+#define BENCH_WAIT_US 1000
+
+// Every payload field carries the sequence number so a torn read can be detected
+#define BENCH_PAYLOAD(sequence) ((float)((sequence) & 0xFFFF))
+
+typedef struct
+{
+    float temperature;
+    float pressure;
+    float altitude;
+    float humidity;
+    uint64_t timestamp_ns;
+    uint32_t sequence;
+} bench_sample_t;
+
+typedef struct
+{
+    uint32_t received;
+    uint32_t batches;
+    uint32_t torn;
+    uint32_t out_of_order;
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+} bench_result_t;
+
+static bench_sample_t sample_ring_buffer[BENCH_RING_CAPACITY];
+static spsc_ring_t sample_ring;
+static atomic_bool producer_done;
+static bench_result_t result;
+
+static uint64_t time_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void *bench_consumer(void *arg)
+{
+    bench_sample_t batch[BENCH_RING_CAPACITY];
+    uint32_t last_sequence = 0;
+
+    (void)arg;
+    while (1)
+    {
+        // The level is checked after the done flag so the last samples are not left behind
+        bool done = atomic_load(&producer_done);
+        if (!spsc_ring_wait(&sample_ring, BENCH_WAIT_US))
+        {
+            if (done)
+                break;
+            continue;
+        }
+
+        uint32_t count = spsc_ring_pop_batch(&sample_ring, batch, BENCH_RING_CAPACITY);
+        uint64_t now = time_ns();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float payload = BENCH_PAYLOAD(batch[i].sequence);
+            if (batch[i].temperature != payload || batch[i].pressure != payload ||
+                batch[i].altitude != payload || batch[i].humidity != payload)
+            {
+                result.torn++;
+            }
+            if (batch[i].sequence <= last_sequence)
+                result.out_of_order++;
+            last_sequence = batch[i].sequence;
+
+            uint64_t latency_ns = now - batch[i].timestamp_ns;
+            result.latency_sum_ns += latency_ns;
+            if (latency_ns > result.latency_max_ns)
+                result.latency_max_ns = latency_ns;
+        }
+        result.received += count;
+        result.batches++;
+    }
+
+    return NULL;
+}
+
+static bool run_benchmark(bool wakeup, uint32_t rate_hz)
+{
+    uint32_t samples = rate_hz ? (uint32_t)((uint64_t)rate_hz * BENCH_PACED_MS / 1000) : BENCH_SAMPLES;
+    uint64_t period_ns = rate_hz ? 1000000000 / rate_hz : 0;
+    bench_sample_t sample;
+    pthread_t consumer;
+
+    result = (bench_result_t){0};
+    spsc_ring_init(&sample_ring, sample_ring_buffer, sizeof(bench_sample_t), BENCH_RING_CAPACITY, wakeup);
+    atomic_store(&producer_done, false);
+    if (pthread_create(&consumer, NULL, bench_consumer, NULL) != 0)
+    {
+        printf("Could not start the consumer thread\n");
+        return false;
+    }
+
+    uint64_t start = time_ns();
+    uint64_t next_sample = start;
+    for (uint32_t sequence = 1; sequence <= samples; sequence++)
+    {
+        if (period_ns)
+        {
+            while (time_ns() < next_sample)
+                ;
+            next_sample += period_ns;
+        }
+
+        sample.temperature = BENCH_PAYLOAD(sequence);
+        sample.pressure = BENCH_PAYLOAD(sequence);
+        sample.altitude = BENCH_PAYLOAD(sequence);
+        sample.humidity = BENCH_PAYLOAD(sequence);
+        sample.timestamp_ns = time_ns();
+        sample.sequence = sequence;
+        spsc_ring_push(&sample_ring, &sample);
+    }
+    atomic_store(&producer_done, true);
+    pthread_join(consumer, NULL);
+    uint64_t end = time_ns();
+
+    bool passed = result.torn == 0 && result.out_of_order == 0 && result.received + sample_ring.dropped == samples;
+    printf("%-7s %8u Hz %8u %8u %7u %10.0f %7u %4u %4u %9.2f %9.1f %s\n",
+           wakeup ? "wakeup" : "spin", rate_hz, samples, result.received, sample_ring.dropped,
+           result.received * 1e9 / (end - start), result.batches, result.torn, result.out_of_order,
+           result.received ? result.latency_sum_ns / 1000.0 / result.received : 0.0, result.latency_max_ns / 1000.0,
+           passed ? "ok" : "FAIL");
+    return passed;
+}
+
+int main()
+{
+    const uint32_t rates[] = BENCH_RATES_HZ;
+    uint32_t failed = 0;
+
+    printf("SPSC ring host benchmark, capacity %d, rate 0 is unthrottled\n", BENCH_RING_CAPACITY);
+    printf("%-7s %11s %8s %8s %7s %10s %7s %4s %4s %9s %9s\n",
+           "wait", "rate", "sent", "received", "dropped", "samples/s", "batches", "torn", "ooo", "lat avg", "lat max");
+
+    for (uint32_t wakeup = 0; wakeup < 2; wakeup++)
+    {
+        for (uint32_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+        {
+            if (!run_benchmark(wakeup, rates[i]))
+                failed++;
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
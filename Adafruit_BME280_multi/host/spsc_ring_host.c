@@ -0,0 +1,62 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "spsc_ring.h"
+
+// Host hooks for spsc_ring.c. The consumer sleeps on a condition variable, the producer only takes
+// the lock when a consumer is waiting, so pushes to a ring nobody waits on stay lock-free.
+
+static pthread_mutex_t doorbell_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t doorbell = PTHREAD_COND_INITIALIZER;
+static atomic_uint waiters;
+
+void spsc_ring_port_signal(spsc_ring_t *ring)
+{
+    (void)ring;
+
+    // Pairs with the fence in spsc_ring_port_wait, either the producer sees the waiter or the
+    // waiter sees the new head
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&waiters) == 0)
+        return;
+
+    pthread_mutex_lock(&doorbell_lock);
+    pthread_cond_broadcast(&doorbell);
+    pthread_mutex_unlock(&doorbell_lock);
+}
+
+void spsc_ring_port_wait(spsc_ring_t *ring, uint32_t timeout_us)
+{
+    struct timespec timeout;
+
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_sec += timeout_us / 1000000;
+    timeout.tv_nsec += (long)(timeout_us % 1000000) * 1000;
+    if (timeout.tv_nsec >= 1000000000)
+    {
+        timeout.tv_sec++;
+        timeout.tv_nsec -= 1000000000;
+    }
+
+    if (!ring->wakeup)
+    {
+        struct timespec now;
+        do
+        {
+            clock_gettime(CLOCK_REALTIME, &now);
+        } while (spsc_ring_level(ring) == 0 &&
+                 (now.tv_sec < timeout.tv_sec || (now.tv_sec == timeout.tv_sec && now.tv_nsec < timeout.tv_nsec)));
+        return;
+    }
+
+    pthread_mutex_lock(&doorbell_lock);
+    atomic_fetch_add(&waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (spsc_ring_level(ring) == 0)
+    {
+        if (pthread_cond_timedwait(&doorbell, &doorbell_lock, &timeout) != 0)
+            break;
+    }
+    atomic_fetch_sub(&waiters, 1);
+    pthread_mutex_unlock(&doorbell_lock);
+}
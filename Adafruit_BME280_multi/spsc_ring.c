@@ -0,0 +1,88 @@
+#include <stdatomic.h>
+#include <string.h>
+#include "spsc_ring.h"
+
+// head and tail are free running counters, the slot is the counter modulo capacity.
+// The fences compile to DMB on the RP2040.
+
+bool spsc_ring_init(spsc_ring_t *ring, void *buffer, uint32_t element_size, uint32_t capacity, bool wakeup)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+        return false;
+
+    ring->buffer = (uint8_t *)buffer;
+    ring->element_size = element_size;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+    ring->wakeup = wakeup;
+    return true;
+}
+
+// Producer side, returns false and counts a drop if the ring is full
+bool spsc_ring_push(spsc_ring_t *ring, const void *element)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= ring->capacity)
+    {
+        ring->dropped++;
+        return false;
+    }
+
+    memcpy(ring->buffer + (head & (ring->capacity - 1)) * ring->element_size, element, ring->element_size);
+
+    // The element must be visible to the other core before the new head
+    atomic_thread_fence(memory_order_seq_cst);
+    ring->head = head + 1;
+
+    // Wake the consumer if it waits in spsc_ring_wait
+    if (ring->wakeup)
+        spsc_ring_port_signal(ring);
+
+    return true;
+}
+
+// Consumer side
+bool spsc_ring_pop(spsc_ring_t *ring, void *element)
+{
+    return spsc_ring_pop_batch(ring, element, 1) == 1;
+}
+
+// Consumer side, copies up to max_elements in order and returns the number copied
+uint32_t spsc_ring_pop_batch(spsc_ring_t *ring, void *elements, uint32_t max_elements)
+{
+    uint32_t tail = ring->tail;
+    uint32_t available = ring->head - tail;
+    uint32_t count = available < max_elements ? available : max_elements;
+
+    // Read the elements only after head has been read
+    atomic_thread_fence(memory_order_seq_cst);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        memcpy((uint8_t *)elements + i * ring->element_size, ring->buffer + ((tail + i) & (ring->capacity - 1)) * ring->element_size, ring->element_size);
+    }
+
+    // The slots must be read before they are handed back to the producer
+    atomic_thread_fence(memory_order_seq_cst);
+    ring->tail = tail + count;
+
+    return count;
+}
+
+uint32_t spsc_ring_level(spsc_ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+// Consumer side, wait until the producer pushed something or timeout_us passed.
+// Returns true if the ring holds elements.
+bool spsc_ring_wait(spsc_ring_t *ring, uint32_t timeout_us)
+{
+    if (spsc_ring_level(ring) == 0)
+        spsc_ring_port_wait(ring, timeout_us);
+
+    return spsc_ring_level(ring) > 0;
+}
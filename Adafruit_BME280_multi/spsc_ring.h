@@ -0,0 +1,35 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single producer / single consumer ring buffer for passing fixed size elements between the two cores.
+// Only memory barriers are used, the producer never blocks and drops the element if the ring is full.
+// The ring itself has no platform dependencies, waiting and waking go through the spsc_ring_port_*
+// hooks, implemented in spsc_ring_pico.c for the RP2040 and in host/spsc_ring_host.c with pthreads.
+typedef struct
+{
+    uint8_t *buffer;
+    uint32_t element_size;
+    uint32_t capacity; // power of two
+    volatile uint32_t head; // written by the producer only
+    volatile uint32_t tail; // written by the consumer only
+    volatile uint32_t dropped;
+    bool wakeup; // spsc_ring_wait sleeps until the producer signals instead of spinning
+} spsc_ring_t;
+
+bool spsc_ring_init(spsc_ring_t *ring, void *buffer, uint32_t element_size, uint32_t capacity, bool wakeup);
+bool spsc_ring_push(spsc_ring_t *ring, const void *element);
+bool spsc_ring_pop(spsc_ring_t *ring, void *element);
+uint32_t spsc_ring_pop_batch(spsc_ring_t *ring, void *elements, uint32_t max_elements);
+uint32_t spsc_ring_level(spsc_ring_t *ring);
+bool spsc_ring_wait(spsc_ring_t *ring, uint32_t timeout_us);
+
+// Platform hooks. spsc_ring_port_signal is called by the producer after every push to a ring with
+// wakeup set and must never block. spsc_ring_port_wait returns once the ring holds elements or
+// timeout_us passed, it may also return early.
+void spsc_ring_port_signal(spsc_ring_t *ring);
+void spsc_ring_port_wait(spsc_ring_t *ring, uint32_t timeout_us);
+
+#endif // SPSC_RING_H
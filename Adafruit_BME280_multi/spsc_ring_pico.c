@@ -0,0 +1,29 @@
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "spsc_ring.h"
+
+// RP2040 hooks for spsc_ring.c. The wakeup uses the event register, SEV on the producer core and
+// WFE on the consumer core, so the SIO FIFO stays free for multicore_lockout and flash_safe_execute.
+
+void spsc_ring_port_signal(spsc_ring_t *ring)
+{
+    (void)ring;
+    __sev();
+}
+
+void spsc_ring_port_wait(spsc_ring_t *ring, uint32_t timeout_us)
+{
+    absolute_time_t timeout = make_timeout_time_us(timeout_us);
+
+    // A SEV between the level check and the WFE is latched, so no wakeup is lost
+    if (ring->wakeup)
+    {
+        while (spsc_ring_level(ring) == 0 && !best_effort_wfe_or_timeout(timeout))
+            ;
+    }
+    else
+    {
+        while (spsc_ring_level(ring) == 0 && !time_reached(timeout))
+            tight_loop_contents();
+    }
+}
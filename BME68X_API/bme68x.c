@@ -91,11 +91,26 @@ static uint8_t calc_res_heat(uint16_t temp, const struct bme68x_dev *dev);
 #endif
 
 /* This internal API is used to read a single data of the sensor */
-static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bme68x_dev *dev);
+static int8_t read_field_data(uint8_t index, struct bme68x_data *data, uint8_t tries, struct bme68x_dev *dev);
 
 /* This internal API is used to read all data fields of the sensor */
 static int8_t read_all_field_data(struct bme68x_data *const data[], struct bme68x_dev *dev);
 
+/* This internal API is used to read the heater settings of all profile steps unless they are cached */
+static int8_t get_heatr_set(struct bme68x_dev *dev);
+
+/* This internal API is used to copy the cached heater settings of a profile step into the field data */
+static void copy_heatr_set(struct bme68x_data *data, const struct bme68x_dev *dev);
+
+/* This internal API is used to parse the status and indexes of a data field */
+static void parse_field_status(const uint8_t *buff, struct bme68x_data *data, const struct bme68x_dev *dev);
+
+/* This internal API is used to compensate the raw data of a data field */
+static void calc_field_data(const uint8_t *buff, struct bme68x_data *data, struct bme68x_dev *dev);
+
+/* This internal API is used to order two new data fields by their sub-measurement index */
+static void order_fields(uint8_t *low_off, uint8_t *high_off, const uint8_t *buff);
+
 /* This internal API is used to switch between SPI memory pages */
 static int8_t set_mem_page(uint8_t reg_addr, struct bme68x_dev *dev);
 
@@ -202,6 +217,13 @@ int8_t bme68x_set_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_
                     tmp_buff[(2 * index)] = reg_addr[index];
                 }
 
+                /* The cached heater settings are read again after any of them is written */
+                if ((reg_addr[index] >= BME68X_REG_IDAC_HEAT0) &&
+                    (reg_addr[index] < (BME68X_REG_IDAC_HEAT0 + BME68X_LEN_HEATR_SET)))
+                {
+                    dev->heatr_set_valid = 0;
+                }
+
                 tmp_buff[(2 * index) + 1] = reg_data[index];
             }
 
@@ -286,6 +308,7 @@ int8_t bme68x_soft_reset(struct bme68x_dev *dev)
         /* Reset the device */
         if (rslt == BME68X_OK)
         {
+            dev->heatr_set_valid = 0;
             rslt = bme68x_set_regs(&reg_addr, &soft_rst_cmd, 1, dev);
 
             if (rslt == BME68X_OK)
@@ -554,7 +577,7 @@ int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_dat
         /* Reading the sensor data in forced mode only */
         if (op_mode == BME68X_FORCED_MODE)
         {
-            rslt = read_field_data(0, data, dev);
+            rslt = read_field_data(0, data, BME68X_FORCED_TRIES, dev);
             if (rslt == BME68X_OK)
             {
                 if (data->status & BME68X_NEW_DATA_MSK)
@@ -624,6 +647,123 @@ int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_dat
     return rslt;
 }
 
+/*
+ * @brief This API reads the data fields of the sensor in one burst and
+ * compensates only the new fields, straight into the caller's array.
+ */
+int8_t bme68x_get_new_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_data, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t buff[BME68X_LEN_FIELD * BME68X_N_FIELDS];
+    uint8_t field_off[BME68X_N_FIELDS];
+    uint8_t n_fields = 0, new_fields = 0;
+    uint8_t i, off;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (data != NULL) && (n_data != NULL))
+    {
+        if (op_mode == BME68X_FORCED_MODE)
+        {
+            n_fields = 1;
+        }
+        else if ((op_mode == BME68X_PARALLEL_MODE) || (op_mode == BME68X_SEQUENTIAL_MODE))
+        {
+            n_fields = BME68X_N_FIELDS;
+        }
+        else
+        {
+            rslt = BME68X_W_DEFINE_OP_MODE;
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = bme68x_get_regs(BME68X_REG_FIELD0, buff, (uint32_t)BME68X_LEN_FIELD * n_fields, dev);
+        }
+
+        /* Only the fields with the new data bit set are decoded */
+        for (i = 0; (i < n_fields) && (rslt == BME68X_OK); i++)
+        {
+            off = (uint8_t)(i * BME68X_LEN_FIELD_OFFSET);
+            if (buff[off] & BME68X_NEW_DATA_MSK)
+            {
+                field_off[new_fields++] = off;
+            }
+        }
+
+        if ((rslt == BME68X_OK) && (new_fields > 0))
+        {
+            rslt = get_heatr_set(dev);
+        }
+
+        /* Sorting network, oldest field first */
+        if ((rslt == BME68X_OK) && (new_fields > 1))
+        {
+            order_fields(&field_off[0], &field_off[1], buff);
+            if (new_fields > 2)
+            {
+                order_fields(&field_off[1], &field_off[2], buff);
+                order_fields(&field_off[0], &field_off[1], buff);
+            }
+        }
+
+        for (i = 0; (i < new_fields) && (rslt == BME68X_OK); i++)
+        {
+            parse_field_status(&buff[field_off[i]], &data[i], dev);
+            copy_heatr_set(&data[i], dev);
+            calc_field_data(&buff[field_off[i]], &data[i], dev);
+        }
+
+        if (rslt != BME68X_OK)
+        {
+            new_fields = 0;
+        }
+        else if (new_fields == 0)
+        {
+            rslt = BME68X_W_NO_NEW_DATA;
+        }
+
+        *n_data = new_fields;
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API reads a single data field of the sensor in one attempt,
+ * without polling for new data.
+ */
+int8_t bme68x_get_field_data(uint8_t field, struct bme68x_data *data, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (data != NULL))
+    {
+        if (field < BME68X_N_FIELDS)
+        {
+            rslt = read_field_data(field, data, 1, dev);
+            if ((rslt == BME68X_OK) && !(data->status & BME68X_NEW_DATA_MSK))
+            {
+                rslt = BME68X_W_NO_NEW_DATA;
+            }
+        }
+        else
+        {
+            rslt = BME68X_E_INVALID_LENGTH;
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
 /*
  * @brief This API is used to set the gas configuration of the sensor.
  */
@@ -888,10 +1028,12 @@ static uint32_t calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev)
 
     var1 = ((int32_t)dev->calib.par_p9 * (int32_t)(((pressure_comp >> 3) * (pressure_comp >> 3)) >> 13)) >> 12;
     var2 = ((int32_t)(pressure_comp >> 2) * (int32_t)dev->calib.par_p8) >> 13;
+    /* The cube alone fits 32 bits, times par_p10 it overflows above roughly 1075 hPa */
     var3 =
-        ((int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) *
-         (int32_t)dev->calib.par_p10) >>
-        17;
+        (int32_t)(((uint64_t)((uint32_t)(pressure_comp >> 8) * (uint32_t)(pressure_comp >> 8) *
+                              (uint32_t)(pressure_comp >> 8)) *
+                   dev->calib.par_p10) >>
+                  17);
     pressure_comp = (int32_t)(pressure_comp) + ((var1 + var2 + var3 + ((int32_t)dev->calib.par_p7 << 7)) >> 4);
 
     /*lint -restore */
@@ -1195,16 +1337,10 @@ static uint8_t calc_gas_wait(uint16_t dur)
 }
 
 /* This internal API is used to read a single data of the sensor */
-static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bme68x_dev *dev)
+static int8_t read_field_data(uint8_t index, struct bme68x_data *data, uint8_t tries, struct bme68x_dev *dev)
 {
     int8_t rslt = BME68X_OK;
     uint8_t buff[BME68X_LEN_FIELD] = {0};
-    uint8_t gas_range_l, gas_range_h;
-    uint32_t adc_temp;
-    uint32_t adc_pres;
-    uint16_t adc_hum;
-    uint16_t adc_gas_res_low, adc_gas_res_high;
-    uint8_t tries = 5;
 
     while ((tries) && (rslt == BME68X_OK))
     {
@@ -1218,61 +1354,22 @@ static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bm
             break;
         }
 
-        data->status = buff[0] & BME68X_NEW_DATA_MSK;
-        data->gas_index = buff[0] & BME68X_GAS_INDEX_MSK;
-        data->meas_index = buff[1];
-
-        /* read the raw data from the sensor */
-        adc_pres = (uint32_t)(((uint32_t)buff[2] * 4096) | ((uint32_t)buff[3] * 16) | ((uint32_t)buff[4] / 16));
-        adc_temp = (uint32_t)(((uint32_t)buff[5] * 4096) | ((uint32_t)buff[6] * 16) | ((uint32_t)buff[7] / 16));
-        adc_hum = (uint16_t)(((uint32_t)buff[8] * 256) | (uint32_t)buff[9]);
-        adc_gas_res_low = (uint16_t)((uint32_t)buff[13] * 4 | (((uint32_t)buff[14]) / 64));
-        adc_gas_res_high = (uint16_t)((uint32_t)buff[15] * 4 | (((uint32_t)buff[16]) / 64));
-        gas_range_l = buff[14] & BME68X_GAS_RANGE_MSK;
-        gas_range_h = buff[16] & BME68X_GAS_RANGE_MSK;
-        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-        {
-            data->status |= buff[16] & BME68X_GASM_VALID_MSK;
-            data->status |= buff[16] & BME68X_HEAT_STAB_MSK;
-        }
-        else
-        {
-            data->status |= buff[14] & BME68X_GASM_VALID_MSK;
-            data->status |= buff[14] & BME68X_HEAT_STAB_MSK;
-        }
+        parse_field_status(buff, data, dev);
 
         if ((data->status & BME68X_NEW_DATA_MSK) && (rslt == BME68X_OK))
         {
-            rslt = bme68x_get_regs(BME68X_REG_RES_HEAT0 + data->gas_index, &data->res_heat, 1, dev);
-            if (rslt == BME68X_OK)
-            {
-                rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0 + data->gas_index, &data->idac, 1, dev);
-            }
-
+            rslt = get_heatr_set(dev);
             if (rslt == BME68X_OK)
             {
-                rslt = bme68x_get_regs(BME68X_REG_GAS_WAIT0 + data->gas_index, &data->gas_wait, 1, dev);
-            }
-
-            if (rslt == BME68X_OK)
-            {
-                data->temperature = calc_temperature(adc_temp, dev);
-                data->pressure = calc_pressure(adc_pres, dev);
-                data->humidity = calc_humidity(adc_hum, dev);
-                if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-                {
-                    data->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
-                }
-                else
-                {
-                    data->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, dev);
-                }
+                copy_heatr_set(data, dev);
+                calc_field_data(buff, data, dev);
 
                 break;
             }
         }
 
-        if (rslt == BME68X_OK)
+        /* No point in waiting after the last try */
+        if ((rslt == BME68X_OK) && (tries > 1))
         {
             dev->delay_us(BME68X_PERIOD_POLL, dev->intf_ptr);
         }
@@ -1288,13 +1385,7 @@ static int8_t read_all_field_data(struct bme68x_data *const data[], struct bme68
 {
     int8_t rslt = BME68X_OK;
     uint8_t buff[BME68X_LEN_FIELD * 3] = {0};
-    uint8_t gas_range_l, gas_range_h;
-    uint32_t adc_temp;
-    uint32_t adc_pres;
-    uint16_t adc_hum;
-    uint16_t adc_gas_res_low, adc_gas_res_high;
     uint8_t off;
-    uint8_t set_val[30] = {0}; /* idac, res_heat, gas_wait */
     uint8_t i;
 
     if (!data[0] && !data[1] && !data[2])
@@ -1309,58 +1400,119 @@ static int8_t read_all_field_data(struct bme68x_data *const data[], struct bme68
 
     if (rslt == BME68X_OK)
     {
-        rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0, set_val, 30, dev);
+        rslt = get_heatr_set(dev);
     }
 
     for (i = 0; ((i < 3) && (rslt == BME68X_OK)); i++)
     {
         off = (uint8_t)(i * BME68X_LEN_FIELD);
-        data[i]->status = buff[off] & BME68X_NEW_DATA_MSK;
-        data[i]->gas_index = buff[off] & BME68X_GAS_INDEX_MSK;
-        data[i]->meas_index = buff[off + 1];
-
-        /* read the raw data from the sensor */
-        adc_pres =
-            (uint32_t)(((uint32_t)buff[off + 2] * 4096) | ((uint32_t)buff[off + 3] * 16) |
-                       ((uint32_t)buff[off + 4] / 16));
-        adc_temp =
-            (uint32_t)(((uint32_t)buff[off + 5] * 4096) | ((uint32_t)buff[off + 6] * 16) |
-                       ((uint32_t)buff[off + 7] / 16));
-        adc_hum = (uint16_t)(((uint32_t)buff[off + 8] * 256) | (uint32_t)buff[off + 9]);
-        adc_gas_res_low = (uint16_t)((uint32_t)buff[off + 13] * 4 | (((uint32_t)buff[off + 14]) / 64));
-        adc_gas_res_high = (uint16_t)((uint32_t)buff[off + 15] * 4 | (((uint32_t)buff[off + 16]) / 64));
-        gas_range_l = buff[off + 14] & BME68X_GAS_RANGE_MSK;
-        gas_range_h = buff[off + 16] & BME68X_GAS_RANGE_MSK;
-        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-        {
-            data[i]->status |= buff[off + 16] & BME68X_GASM_VALID_MSK;
-            data[i]->status |= buff[off + 16] & BME68X_HEAT_STAB_MSK;
-        }
-        else
-        {
-            data[i]->status |= buff[off + 14] & BME68X_GASM_VALID_MSK;
-            data[i]->status |= buff[off + 14] & BME68X_HEAT_STAB_MSK;
-        }
+        parse_field_status(&buff[off], data[i], dev);
+        copy_heatr_set(data[i], dev);
+        calc_field_data(&buff[off], data[i], dev);
+    }
 
-        data[i]->idac = set_val[data[i]->gas_index];
-        data[i]->res_heat = set_val[10 + data[i]->gas_index];
-        data[i]->gas_wait = set_val[20 + data[i]->gas_index];
-        data[i]->temperature = calc_temperature(adc_temp, dev);
-        data[i]->pressure = calc_pressure(adc_pres, dev);
-        data[i]->humidity = calc_humidity(adc_hum, dev);
-        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-        {
-            data[i]->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
-        }
-        else
+    return rslt;
+}
+
+/* This internal API is used to parse the status and indexes of a data field */
+static void parse_field_status(const uint8_t *buff, struct bme68x_data *data, const struct bme68x_dev *dev)
+{
+    data->status = buff[0] & BME68X_NEW_DATA_MSK;
+    data->gas_index = buff[0] & BME68X_GAS_INDEX_MSK;
+    data->meas_index = buff[1];
+    if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
+    {
+        data->status |= buff[16] & BME68X_GASM_VALID_MSK;
+        data->status |= buff[16] & BME68X_HEAT_STAB_MSK;
+    }
+    else
+    {
+        data->status |= buff[14] & BME68X_GASM_VALID_MSK;
+        data->status |= buff[14] & BME68X_HEAT_STAB_MSK;
+    }
+}
+
+/* This internal API is used to compensate the raw data of a data field */
+static void calc_field_data(const uint8_t *buff, struct bme68x_data *data, struct bme68x_dev *dev)
+{
+    uint8_t gas_range_l, gas_range_h;
+    uint32_t adc_temp;
+    uint32_t adc_pres;
+    uint16_t adc_hum;
+    uint16_t adc_gas_res_low, adc_gas_res_high;
+
+    /* read the raw data from the sensor */
+    adc_pres = (uint32_t)(((uint32_t)buff[2] * 4096) | ((uint32_t)buff[3] * 16) | ((uint32_t)buff[4] / 16));
+    adc_temp = (uint32_t)(((uint32_t)buff[5] * 4096) | ((uint32_t)buff[6] * 16) | ((uint32_t)buff[7] / 16));
+    adc_hum = (uint16_t)(((uint32_t)buff[8] * 256) | (uint32_t)buff[9]);
+    adc_gas_res_low = (uint16_t)((uint32_t)buff[13] * 4 | (((uint32_t)buff[14]) / 64));
+    adc_gas_res_high = (uint16_t)((uint32_t)buff[15] * 4 | (((uint32_t)buff[16]) / 64));
+    gas_range_l = buff[14] & BME68X_GAS_RANGE_MSK;
+    gas_range_h = buff[16] & BME68X_GAS_RANGE_MSK;
+
+    data->temperature = calc_temperature(adc_temp, dev);
+    data->pressure = calc_pressure(adc_pres, dev);
+    data->humidity = calc_humidity(adc_hum, dev);
+    if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
+    {
+        data->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
+    }
+    else
+    {
+        data->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, dev);
+    }
+}
+
+/* This internal API is used to order two new data fields by their sub-measurement index.
+ * The index is 8-bit and wraps, see sort_sensor_data, so the signed difference decides.
+ * This matches the wrap rules of sort_sensor_data only for indexes the sensor wrote in its
+ * field ring, where new fields are at most 2 apart. Arbitrary index sets can sort differently. */
+static void order_fields(uint8_t *low_off, uint8_t *high_off, const uint8_t *buff)
+{
+    uint8_t temp;
+
+    if ((int8_t)(buff[*high_off + 1] - buff[*low_off + 1]) < 0)
+    {
+        temp = *low_off;
+        *low_off = *high_off;
+        *high_off = temp;
+    }
+}
+
+/* This internal API is used to read the heater settings of all profile steps unless they are cached */
+static int8_t get_heatr_set(struct bme68x_dev *dev)
+{
+    int8_t rslt = BME68X_OK;
+
+    if (!dev->heatr_set_valid)
+    {
+        rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0, dev->heatr_set, BME68X_LEN_HEATR_SET, dev);
+        if (rslt == BME68X_OK)
         {
-            data[i]->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, dev);
+            dev->heatr_set_valid = 1;
         }
     }
 
     return rslt;
 }
 
+/* This internal API is used to copy the cached heater settings of a profile step into the field data */
+static void copy_heatr_set(struct bme68x_data *data, const struct bme68x_dev *dev)
+{
+    if (data->gas_index < BME68X_N_HEATR_STEPS)
+    {
+        data->idac = dev->heatr_set[data->gas_index];
+        data->res_heat = dev->heatr_set[BME68X_N_HEATR_STEPS + data->gas_index];
+        data->gas_wait = dev->heatr_set[(2 * BME68X_N_HEATR_STEPS) + data->gas_index];
+    }
+    else
+    {
+        data->idac = 0;
+        data->res_heat = 0;
+        data->gas_wait = 0;
+    }
+}
+
 /* This internal API is used to switch between SPI memory pages */
 static int8_t set_mem_page(uint8_t reg_addr, struct bme68x_dev *dev)
 {
@@ -214,6 +214,9 @@ extern "C"
      * @details This API reads the pressure, temperature and humidity and gas data
      * from the sensor, compensates the data and store it in the bme68x_data
      * structure instance passed by the user.
+     * In forced mode the field is read BME68X_FORCED_TRIES times, once by default,
+     * so the call does not sleep. A measurement that is not done yet returns
+     * BME68X_W_NO_NEW_DATA, read again later without starting a new measurement.
      *
      * @param[in]  op_mode : Expected operation mode.
      * @param[out] data    : Structure instance to hold the data.
@@ -222,10 +225,56 @@ extern "C"
      *
      * @return Result of API execution status
      * @retval 0 -> Success
+     * @retval > 0 -> Warning, BME68X_W_NO_NEW_DATA if the data is not ready
      * @retval < 0 -> Fail
      */
     int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_data, struct bme68x_dev *dev);
 
+    /*!
+     * \ingroup bme68xApiData
+     * \page bme68x_api_bme68x_get_new_data bme68x_get_new_data
+     * \code
+     * int8_t bme68x_get_new_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_data, struct bme68x_dev *dev);
+     * \endcode
+     * @details This API reads the data fields in one burst and compensates only the
+     * fields that hold new data, directly into the data array, oldest first. Unlike
+     * bme68x_get_data, the remaining entries of the array are left untouched and
+     * forced mode does not poll.
+     *
+     * @param[in]  op_mode : Expected operation mode.
+     * @param[out] data    : Array to hold the new data, 1 entry for forced mode and
+     *                       BME68X_N_FIELDS entries for parallel and sequential mode.
+     * @param[out] n_data  : Number of new data entries written.
+     * @param[in,out] dev  : Structure instance of bme68x_dev
+     *
+     * @return Result of API execution status
+     * @retval 0 -> Success
+     * @retval > 0 -> Warning, BME68X_W_NO_NEW_DATA if no field holds new data
+     * @retval < 0 -> Fail
+     */
+    int8_t bme68x_get_new_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_data, struct bme68x_dev *dev);
+
+    /*!
+     * \ingroup bme68xApiData
+     * \page bme68x_api_bme68x_get_field_data bme68x_get_field_data
+     * \code
+     * int8_t bme68x_get_field_data(uint8_t field, struct bme68x_data *data, struct bme68x_dev *dev);
+     * \endcode
+     * @details This API reads and compensates a single data field in one attempt. Unlike
+     * bme68x_get_data it does not poll, so it suits callers that schedule the read
+     * for the time the field is expected.
+     *
+     * @param[in]  field   : Field to read, 0 to BME68X_N_FIELDS - 1.
+     * @param[out] data    : Structure instance to hold the data.
+     * @param[in,out] dev  : Structure instance of bme68x_dev
+     *
+     * @return Result of API execution status
+     * @retval 0 -> Success
+     * @retval > 0 -> Warning, BME68X_W_NO_NEW_DATA if the field holds no new data
+     * @retval < 0 -> Fail
+     */
+    int8_t bme68x_get_field_data(uint8_t field, struct bme68x_data *data, struct bme68x_dev *dev);
+
     /**
      * \ingroup bme68x
      * \defgroup bme68xApiConfig Configuration
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+
+// Conformance test and cycle benchmark of the BME68X compensation routines. The calc_* routines
+// are static, so the driver is compiled into this file. CMake builds it twice, as
+// bme68x_comp_bench_float and, with BME68X_DO_NOT_USE_FPU, as bme68x_comp_bench_int. Both check
+// the same reference vectors, so passing both shows the two paths agree within the tolerances.
+#include "bme68x.c"
+
+#define BENCH_REPEAT 100
+
+// Tolerances against the float reference
+#define TOL_TEMPERATURE 0.02f // deg C, the integer resolution is 0.01
+#define TOL_PRESSURE 10.0f    // Pa
+#define TOL_HUMIDITY 0.02f    // %RH, the integer resolution is 0.001
+#define TOL_GAS_ABS 100.0f    // Ohm, the integer resolution of the high variant is 100
+#define TOL_GAS_REL 0.001f
+#define TOL_RES_HEAT 1 // Register LSB
+
+#ifdef BME68X_USE_FPU
+#define COMP_MODE "float"
+#define TEMPERATURE_C(x) (x)
+#define HUMIDITY_PERCENT(x) (x)
+#else
+#define COMP_MODE "integer"
+#define TEMPERATURE_C(x) ((x) / 100.0f)
+#define HUMIDITY_PERCENT(x) ((x) / 1000.0f)
+#endif
+
+typedef struct
+{
+    uint32_t temp_adc;
+    uint32_t pres_adc;
+    uint16_t hum_adc;
+    uint16_t gas_adc;
+    uint8_t gas_range;
+    float temperature;    // deg C
+    float pressure;       // Pa
+    float humidity;       // %RH
+    float gas_res_low;    // Ohm, low gas variant
+    float gas_res_high;   // Ohm, high gas variant
+} comp_vector_t;
+
+// Calibration of the reference vectors
+static const struct bme68x_calib_data bench_calib = {
+    .par_h1 = 742, .par_h2 = 1020, .par_h3 = 0, .par_h4 = 45, .par_h5 = 20, .par_h6 = 120, .par_h7 = -100,
+    .par_gh1 = -30, .par_gh2 = -10542, .par_gh3 = 18,
+    .par_t1 = 26286, .par_t2 = 26364, .par_t3 = 3,
+    .par_p1 = 36504, .par_p2 = -10350, .par_p3 = 88, .par_p4 = 7171, .par_p5 = -183, .par_p6 = 30, .par_p7 = 50,
+    .par_p8 = -3176, .par_p9 = -2690, .par_p10 = 30,
+    .res_heat_range = 1, .res_heat_val = 40, .range_sw_err = -3,
+};
+
+// Raw ADC values over the operating range with the float compensation results
+static const comp_vector_t vectors[] = {
+    {544873, 333259, 20416, 381, 13, 39.0729141f, 105092.320f, 45.5753212f, 1084.90857f, 8641.64160f},
+    {412801, 412422, 23263, 391, 1, -2.44352007f, 85096.5312f, 58.4546967f, 4401993.50f, 35111708.0f},
+    {401056, 489640, 24400, 268, 8, -6.13460350f, 72002.3672f, 65.4797134f, 38341.9961f, 304399.531f},
+    {488502, 437253, 14798, 227, 2, 21.3505287f, 84352.3594f, 13.0828409f, 2548076.75f, 20220920.0f},
+    {557208, 336284, 14650, 59, 12, 42.9513512f, 105217.008f, 13.2844114f, 2967.76416f, 23383.2656f},
+    {413768, 489318, 15417, 767, 11, -2.13961577f, 72552.8828f, 15.1103315f, 3273.15625f, 26332.0312f},
+    {535628, 467113, 24038, 540, 6, 36.1661530f, 81246.6562f, 69.0819550f, 122413.148f, 979904.312f},
+    {422963, 459197, 18268, 738, 4, 0.750197530f, 77863.2656f, 29.4711571f, 426717.000f, 3431923.00f},
+    {506573, 357282, 18972, 398, 15, 27.0314598f, 98904.6172f, 35.5163879f, 267.123322f, 2131.06030f},
+    {416677, 321828, 22436, 803, 8, -1.22538257f, 100183.836f, 53.3576889f, 25648.3281f, 206077.688f},
+    {447095, 370683, 15060, 609, 7, 8.33486462f, 93635.5859f, 13.8229637f, 58674.0156f, 466833.812f},
+    {400784, 405866, 15117, 986, 9, -6.22008276f, 85616.8125f, 13.5954142f, 11508.1289f, 92787.2422f},
+    {413896, 466182, 17922, 862, 2, -2.09938860f, 76341.4219f, 27.4743404f, 1582089.50f, 12735328.0f},
+    {391416, 479249, 21775, 228, 4, -9.16403961f, 73305.3125f, 48.6110344f, 635771.438f, 5050555.00f},
+    {575107, 326610, 14758, 80, 0, 48.5795517f, 107899.398f, 14.1101284f, 11870101.0f, 93622856.0f},
+    {383941, 421109, 23412, 890, 8, -11.5130386f, 82381.2266f, 58.5593796f, 24338.0488f, 195793.500f},
+};
+
+// Heater target temperatures with the float res_heat register values, at 25 deg C ambient
+static const uint16_t res_heat_temps[] = {200, 250, 300, 350, 400};
+static const uint8_t res_heat_values[] = {86, 99, 112, 125, 138};
+
+static struct bme68x_dev dev;
+
+static bool within(float value, float reference, float tolerance)
+{
+    float diff = value - reference;
+
+    return diff <= tolerance && diff >= -tolerance;
+}
+
+// Returns the number of failed checks
+static uint32_t test_conformance()
+{
+    uint32_t failures = 0;
+
+    for (uint32_t i = 0; i < count_of(vectors); i++)
+    {
+        const comp_vector_t *v = &vectors[i];
+        float temperature = TEMPERATURE_C(calc_temperature(v->temp_adc, &dev));
+        float pressure = calc_pressure(v->pres_adc, &dev);
+        float humidity = HUMIDITY_PERCENT(calc_humidity(v->hum_adc, &dev));
+        float gas_res_low = calc_gas_resistance_low(v->gas_adc, v->gas_range, &dev);
+        float gas_res_high = calc_gas_resistance_high(v->gas_adc, v->gas_range);
+
+        if (!within(temperature, v->temperature, TOL_TEMPERATURE) ||
+            !within(pressure, v->pressure, TOL_PRESSURE) ||
+            !within(humidity, v->humidity, TOL_HUMIDITY) ||
+            !within(gas_res_low, v->gas_res_low, TOL_GAS_ABS + TOL_GAS_REL * v->gas_res_low) ||
+            !within(gas_res_high, v->gas_res_high, TOL_GAS_ABS + TOL_GAS_REL * v->gas_res_high))
+        {
+            printf("vector %lu: %.2f C %.1f Pa %.3f %% %.0f/%.0f ohm, expected %.2f C %.1f Pa %.3f %% %.0f/%.0f ohm\n",
+                   i, temperature, pressure, humidity, gas_res_low, gas_res_high,
+                   v->temperature, v->pressure, v->humidity, v->gas_res_low, v->gas_res_high);
+            failures++;
+        }
+    }
+
+    for (uint32_t i = 0; i < count_of(res_heat_temps); i++)
+    {
+        int res_heat = calc_res_heat(res_heat_temps[i], &dev);
+
+        if (res_heat < res_heat_values[i] - TOL_RES_HEAT || res_heat > res_heat_values[i] + TOL_RES_HEAT)
+        {
+            printf("res_heat %u C: %d, expected %u\n", res_heat_temps[i], res_heat, res_heat_values[i]);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+// Average cycles of one call, the SysTick counts down at the processor clock
+#define BENCH_CALL(name, prepare, call)                                                   \
+    do                                                                                    \
+    {                                                                                     \
+        uint32_t total = 0;                                                               \
+        for (uint32_t r = 0; r < BENCH_REPEAT; r++)                                       \
+        {                                                                                 \
+            for (uint32_t i = 0; i < count_of(vectors); i++)                              \
+            {                                                                             \
+                const comp_vector_t *v = &vectors[i];                                     \
+                prepare;                                                                  \
+                uint32_t start = systick_hw->cvr;                                         \
+                volatile __typeof__(call) result = call;                                  \
+                total += (start - systick_hw->cvr) & 0xFFFFFF;                            \
+                (void)result;                                                             \
+            }                                                                             \
+        }                                                                                 \
+        printf("%-26s %8.1f\n", name, (float)total / (BENCH_REPEAT * count_of(vectors)) - overhead); \
+    } while (0)
+
+static void test_cycles()
+{
+    uint32_t total = 0;
+    float overhead;
+
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+
+    // Cost of reading the counter and storing a result
+    for (uint32_t i = 0; i < BENCH_REPEAT; i++)
+    {
+        uint32_t start = systick_hw->cvr;
+        volatile uint32_t result = i;
+        total += (start - systick_hw->cvr) & 0xFFFFFF;
+        (void)result;
+    }
+    overhead = (float)total / BENCH_REPEAT;
+
+    printf("%-26s %8s\n", "routine (" COMP_MODE ")", "cycles");
+    BENCH_CALL("calc_temperature", (void)v, calc_temperature(v->temp_adc, &dev));
+    BENCH_CALL("calc_pressure", calc_temperature(v->temp_adc, &dev), calc_pressure(v->pres_adc, &dev));
+    BENCH_CALL("calc_humidity", calc_temperature(v->temp_adc, &dev), calc_humidity(v->hum_adc, &dev));
+    BENCH_CALL("calc_gas_resistance_low", (void)v, calc_gas_resistance_low(v->gas_adc, v->gas_range, &dev));
+    BENCH_CALL("calc_gas_resistance_high", (void)v, calc_gas_resistance_high(v->gas_adc, v->gas_range));
+    BENCH_CALL("calc_res_heat", (void)v, calc_res_heat(200 + i * 10, &dev));
+}
+
+int main()
+{
+    stdio_init_all();
+
+    // Sleep for 3 seconds to give time to open the serial terminal
+    sleep_ms(3000);
+
+    dev.calib = bench_calib;
+    dev.amb_temp = 25;
+
+    while (1)
+    {
+        uint32_t failures = test_conformance();
+        printf("BME68X %s compensation: %lu vectors, %lu failures\n", COMP_MODE, count_of(vectors), failures);
+
+        test_cycles();
+
+        printf("\n");
+        sleep_ms(10000);
+    }
+
+    return 0;
+}
@@ -97,6 +97,13 @@
 #define BME68X_PERIOD_POLL UINT32_C(10000)
 #endif
 
+/* Reads of the forced mode field before giving up (value can be given by user). The default 1
+ * makes bme68x_get_data return BME68X_W_NO_NEW_DATA at once if the measurement is not done,
+ * larger values sleep BME68X_PERIOD_POLL between the reads like the original driver */
+#ifndef BME68X_FORCED_TRIES
+#define BME68X_FORCED_TRIES UINT8_C(1)
+#endif
+
 /* BME68X unique chip identifier */
 #define BME68X_CHIP_ID UINT8_C(0x61)
 
@@ -333,6 +340,15 @@
 /* Length between two fields */
 #define BME68X_LEN_FIELD_OFFSET UINT8_C(17)
 
+/* Number of data fields, used as a ring in parallel and sequential mode */
+#define BME68X_N_FIELDS UINT8_C(3)
+
+/* Number of heater profile steps */
+#define BME68X_N_HEATR_STEPS UINT8_C(10)
+
+/* Length of the idac, res_heat and gas_wait registers of all heater profile steps */
+#define BME68X_LEN_HEATR_SET UINT8_C(30)
+
 /* Length of the configuration register */
 #define BME68X_LEN_CONFIG UINT8_C(5)
 
@@ -952,6 +968,15 @@ struct bme68x_dev
     /*! Sensor calibration data */
     struct bme68x_calib_data calib;
 
+    /*!
+     * Copy of the idac, res_heat and gas_wait registers of the heater profile
+     * steps, read once after the registers were written
+     */
+    uint8_t heatr_set[BME68X_LEN_HEATR_SET];
+
+    /*! Set when heatr_set matches the sensor registers */
+    uint8_t heatr_set_valid;
+
     /*! Read function pointer */
     bme68x_read_fptr_t read;
 
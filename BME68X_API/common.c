@@ -31,6 +31,9 @@
 /*!                Static variable definition                                 */
 static uint8_t dev_addr;
 
+/* Bus traffic of the read and write functions */
+static struct bme68x_bus_stats bus_stats;
+
 /******************************************************************************/
 /*!                User interface functions                                   */
 
@@ -41,6 +44,9 @@ BME68X_INTF_RET_TYPE bme68x_i2c_read(uint8_t reg_addr, uint8_t *reg_data, uint32
 {
     uint8_t device_addr = *(uint8_t *)intf_ptr;
 
+    bus_stats.transactions++;
+    bus_stats.bytes += len + 1;
+
     return i2c_write_blocking(I2C_CHANNEL, device_addr, &reg_addr, 1, true) == PICO_ERROR_GENERIC ||
                    i2c_read_blocking(I2C_CHANNEL, device_addr, reg_data, len, false) == PICO_ERROR_GENERIC
                ? BME68X_E_COM_FAIL
@@ -57,6 +63,9 @@ BME68X_INTF_RET_TYPE bme68x_i2c_write(uint8_t reg_addr, const uint8_t *reg_data,
     temp_buff[0] = reg_addr;
     memcpy(&temp_buff[1], reg_data, len);
 
+    bus_stats.transactions++;
+    bus_stats.bytes += len + 1;
+
     return i2c_write_blocking(I2C_CHANNEL, device_addr, temp_buff, len + 1, false) == PICO_ERROR_GENERIC ? BME68X_E_COM_FAIL : BME68X_OK;
 }
 
@@ -69,6 +78,9 @@ BME68X_INTF_RET_TYPE bme68x_spi_read(uint8_t reg_addr, uint8_t *reg_data, uint32
     uint8_t temp_buff[256]; /* Typically temp_buff size is len + 1 */
     temp_buff[0] = reg_addr | 0x80;
 
+    bus_stats.transactions++;
+    bus_stats.bytes += len + 1;
+
     gpio_put(device_addr, 0);                  // Set CS low
     spi_write_blocking(spi0, temp_buff, 1);    // Send register address
     spi_read_blocking(spi0, 0, reg_data, len); // Read data
@@ -87,6 +99,9 @@ BME68X_INTF_RET_TYPE bme68x_spi_write(uint8_t reg_addr, const uint8_t *reg_data,
     temp_buff[0] = reg_addr;
     memcpy(&temp_buff[1], reg_data, len);
 
+    bus_stats.transactions++;
+    bus_stats.bytes += len + 1;
+
     gpio_put(device_addr, 0);                     // Set CS low
     spi_write_blocking(spi0, temp_buff, len + 1); // Send register address and data
     gpio_put(device_addr, 1);                     // Set CS high
@@ -102,6 +117,54 @@ void bme68x_delay_us(uint32_t period, void *intf_ptr)
     sleep_us(period);
 }
 
+void bme68x_data_to_fixed(const struct bme68x_data *data, struct bme68x_fixed_data *fixed)
+{
+#ifdef BME68X_USE_FPU
+    float temperature = data->temperature * 100.0f;
+
+    fixed->temperature = (int16_t)(temperature < 0.0f ? temperature - 0.5f : temperature + 0.5f);
+    fixed->pressure = (uint32_t)(data->pressure + 0.5f);
+    fixed->humidity = (uint32_t)(data->humidity * 1000.0f + 0.5f);
+    fixed->gas_resistance = (uint32_t)(data->gas_resistance + 0.5f);
+#else
+    fixed->temperature = data->temperature;
+    fixed->pressure = data->pressure;
+    fixed->humidity = data->humidity;
+    fixed->gas_resistance = data->gas_resistance;
+#endif
+}
+
+int bme68x_format_data(char *buff, size_t len, const struct bme68x_data *data)
+{
+    struct bme68x_fixed_data fixed;
+    uint16_t temperature;
+
+    bme68x_data_to_fixed(data, &fixed);
+    temperature = (uint16_t)(fixed.temperature < 0 ? -fixed.temperature : fixed.temperature);
+
+    return snprintf(buff,
+                    len,
+                    "Temperature: %s%u.%02u C, Pressure: %lu Pa, Humidity: %lu.%03lu %%, Gas_resistance: %lu ohm",
+                    fixed.temperature < 0 ? "-" : "",
+                    temperature / 100,
+                    temperature % 100,
+                    (long unsigned int)fixed.pressure,
+                    (long unsigned int)(fixed.humidity / 1000),
+                    (long unsigned int)(fixed.humidity % 1000),
+                    (long unsigned int)fixed.gas_resistance);
+}
+
+void bme68x_get_bus_stats(struct bme68x_bus_stats *stats)
+{
+    *stats = bus_stats;
+}
+
+void bme68x_reset_bus_stats(void)
+{
+    bus_stats.transactions = 0;
+    bus_stats.bytes = 0;
+}
+
 void bme68x_check_rslt(const char api_name[], int8_t rslt)
 {
     switch (rslt)
@@ -16,6 +16,37 @@ extern "C"
 #include "hardware/dma.h"
 #include "pico/cyw43_arch.h"
 
+    /*!
+     *  @brief Bus traffic of the read and write functions, one transaction per call.
+     *  Bytes include the register address byte.
+     */
+    struct bme68x_bus_stats
+    {
+        uint32_t transactions;
+        uint32_t bytes;
+    };
+
+    /*! Buffer length that fits any string of bme68x_format_data */
+#define BME68X_DATA_STRING_LEN 128
+
+    /*!
+     *  @brief Sensor data in the fixed-point units of the integer build, in both builds.
+     */
+    struct bme68x_fixed_data
+    {
+        /*! Temperature in degree celsius x100 */
+        int16_t temperature;
+
+        /*! Pressure in Pascal */
+        uint32_t pressure;
+
+        /*! Humidity in % relative humidity x1000 */
+        uint32_t humidity;
+
+        /*! Gas resistance in Ohms */
+        uint32_t gas_resistance;
+    };
+
     /*!
      *  @brief Function to select the interface between SPI and I2C.
      *
@@ -110,6 +141,43 @@ extern "C"
      */
     void bme68x_check_rslt(const char api_name[], int8_t rslt);
 
+    /*!
+     *  @brief Converts the compensated data to fixed-point, rounding the float build values.
+     *
+     *  @param[in] data     : Compensated data
+     *  @param[out] fixed   : Fixed-point data
+     *
+     *  @return void.
+     */
+    void bme68x_data_to_fixed(const struct bme68x_data *data, struct bme68x_fixed_data *fixed);
+
+    /*!
+     *  @brief Formats the compensated data without float printf, so both builds print the same way.
+     *
+     *  @param[out] buff    : Buffer for the string, BME68X_DATA_STRING_LEN fits any data
+     *  @param[in] len      : Length of the buffer
+     *  @param[in] data     : Compensated data
+     *
+     *  @return Length of the string, as snprintf.
+     */
+    int bme68x_format_data(char *buff, size_t len, const struct bme68x_data *data);
+
+    /*!
+     *  @brief Gets the bus traffic counted since the last reset.
+     *
+     *  @param[out] stats   : Bus traffic counters
+     *
+     *  @return void.
+     */
+    void bme68x_get_bus_stats(struct bme68x_bus_stats *stats);
+
+    /*!
+     *  @brief Resets the bus traffic counters.
+     *
+     *  @return void.
+     */
+    void bme68x_reset_bus_stats(void);
+
     /*!
      *  @brief Deinitializes spi and i2c interfaces.
      *
@@ -0,0 +1,121 @@
+#include <stdbool.h>
+
+#include "field_ring.h"
+
+/*
+ * The sensor counts the shared heater duration in 0.477 ms steps with a 4^n multiplier, see
+ * calc_heatr_dur_shared. Assuming whole milliseconds makes every step up to 5 % shorter than
+ * scheduled, and since a field that is already written tells nothing about how late the read
+ * is, that error adds up until fields are overwritten unread.
+ */
+static uint32_t shared_heatr_us(uint16_t dur)
+{
+    uint32_t steps = 0x3F;
+    uint32_t scale = 64;
+
+    if (dur < 0x783)
+    {
+        steps = ((uint32_t)dur * 1000) / 477;
+        scale = 1;
+        while (steps > 0x3F)
+        {
+            steps >>= 2;
+            scale <<= 2;
+        }
+    }
+
+    return steps * scale * 477;
+}
+
+/* Time from the previous field to the field measured with the next heater step, less the lead */
+static uint32_t next_field_delay(const struct field_ring *ring)
+{
+    const struct bme68x_heatr_conf *conf = ring->heatr_conf;
+    uint32_t step_us = ring->meas_dur + (uint32_t)conf->heatr_dur_prof[ring->gas_index % conf->profile_len] * ring->shared_heatr_us;
+
+    return (step_us > FIELD_LEAD_US) ? (step_us - FIELD_LEAD_US) : 0;
+}
+
+/* Read all fields once and return the newest, or false if none holds new data yet */
+static bool find_newest_field(struct field_ring *ring, uint8_t *field, struct bme68x_data *newest, struct bme68x_dev *dev)
+{
+    struct bme68x_data data;
+    bool found = false;
+
+    for (uint8_t i = 0; i < BME68X_N_FIELDS; i++)
+    {
+        ring->reads++;
+        if (bme68x_get_field_data(i, &data, dev) != BME68X_OK)
+        {
+            continue;
+        }
+
+        if (!found || ((int8_t)(data.meas_index - newest->meas_index) > 0))
+        {
+            *newest = data;
+            *field = i;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+uint32_t field_ring_init(struct field_ring *ring, uint32_t meas_dur, const struct bme68x_heatr_conf *heatr_conf)
+{
+    ring->meas_dur = meas_dur;
+    ring->heatr_conf = heatr_conf;
+    ring->shared_heatr_us = shared_heatr_us(heatr_conf->shared_heatr_dur);
+    ring->field = 0;
+    ring->gas_index = 0;
+    ring->retries = 0;
+    ring->reads = 0;
+    ring->misses = 0;
+    ring->resyncs = 0;
+
+    return next_field_delay(ring);
+}
+
+/*
+ * The new data bit is only checked through the status byte that bme68x_get_field_data reads with
+ * the field, a separate status read would clear it before the data is read.
+ */
+uint8_t field_ring_poll(struct field_ring *ring, struct bme68x_data *data, uint32_t *delay_us, struct bme68x_dev *dev)
+{
+    uint8_t field = 0;
+
+    ring->reads++;
+    if (bme68x_get_field_data(ring->field, data, dev) == BME68X_OK)
+    {
+        ring->field = (uint8_t)((ring->field + 1) % BME68X_N_FIELDS);
+        ring->gas_index = (uint8_t)((data->gas_index + 1) % ring->heatr_conf->profile_len);
+        ring->retries = 0;
+        *delay_us = next_field_delay(ring);
+
+        return 1;
+    }
+
+    if (++ring->retries < FIELD_MAX_RETRIES)
+    {
+        ring->misses++;
+        *delay_us = FIELD_RETRY_US;
+
+        return 0;
+    }
+
+    /* Lost track of the ring, e.g. after a bus error, start over from the newest field */
+    ring->resyncs++;
+    ring->retries = 0;
+    if (find_newest_field(ring, &field, data, dev))
+    {
+        ring->field = (uint8_t)((field + 1) % BME68X_N_FIELDS);
+        ring->gas_index = (uint8_t)((data->gas_index + 1) % ring->heatr_conf->profile_len);
+        *delay_us = next_field_delay(ring);
+
+        return 1;
+    }
+
+    *delay_us = next_field_delay(ring);
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef FIELD_RING_H_
+#define FIELD_RING_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /*__cplusplus */
+
+#include "bme68x.h"
+
+/* The first read of a field is scheduled this long before it is expected */
+#define FIELD_LEAD_US UINT32_C(2000)
+
+/* Interval between reads of a field that has not been written yet */
+#define FIELD_RETRY_US UINT32_C(500)
+
+/* Reads after which the field ring position is considered lost */
+#define FIELD_MAX_RETRIES UINT8_C(40)
+
+    /*!
+     *  @brief Read schedule of the parallel mode field ring. The sensor writes the fields as a ring
+     *  in the order of the heater profile, so the next field and the time until it is written are
+     *  known. The schedule has no platform dependencies, main.c runs it from a hardware alarm and
+     *  the host bench against the simulated sensor.
+     */
+    struct field_ring
+    {
+        /*! Measurement duration from bme68x_get_meas_dur */
+        uint32_t meas_dur;
+
+        /*! Heater profile the sensor runs */
+        const struct bme68x_heatr_conf *heatr_conf;
+
+        /*! Shared heater duration as the sensor runs it, in microseconds */
+        uint32_t shared_heatr_us;
+
+        /*! Field written next and its heater profile step */
+        uint8_t field;
+        uint8_t gas_index;
+
+        /*! Reads of the current field without new data */
+        uint8_t retries;
+
+        /*! Field reads, reads without new data and resyncs, the caller clears them */
+        uint32_t reads;
+        uint32_t misses;
+        uint32_t resyncs;
+    };
+
+    /*!
+     *  @brief Starts the schedule at field 0 and heater step 0, call it when parallel mode is set.
+     *
+     *  @param[out] ring        : Read schedule
+     *  @param[in] meas_dur     : Measurement duration from bme68x_get_meas_dur
+     *  @param[in] heatr_conf   : Heater profile set with bme68x_set_heatr_conf, must stay valid
+     *
+     *  @return Delay until the first call of field_ring_poll in microseconds.
+     */
+    uint32_t field_ring_init(struct field_ring *ring, uint32_t meas_dur, const struct bme68x_heatr_conf *heatr_conf);
+
+    /*!
+     *  @brief Reads the field that is due in one transaction. If it was not written yet it is read
+     *  again after FIELD_RETRY_US, after FIELD_MAX_RETRIES the newest field of the sensor is
+     *  searched instead.
+     *
+     *  @param[in,out] ring     : Read schedule
+     *  @param[out] data        : New field, valid if 1 is returned
+     *  @param[out] delay_us    : Delay until the next call in microseconds
+     *  @param[in,out] dev      : Structure instance of bme68x_dev
+     *
+     *  @return Number of new fields written to data, 0 or 1.
+     */
+    uint8_t field_ring_poll(struct field_ring *ring, struct bme68x_data *data, uint32_t *delay_us, struct bme68x_dev *dev);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* FIELD_RING_H_ */
@@ -0,0 +1,416 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bme68x.h"
+#include "bme68x_sim.h"
+#include "field_ring.h"
+
+// Host run of the BME68X driver against the simulated sensor. Every case runs the driver through
+// init, configuration and a stream of samples, checks the samples and reports the samples per
+// second of driver work, the virtual sensor time and the bus traffic per sample. CMake builds it
+// as bme68x_host_bench and, with BME68X_DO_NOT_USE_FPU, as bme68x_host_bench_int. The exit status
+// is nonzero if any check failed.
+#define BENCH_SAMPLES 20000
+#define BENCH_I2C_HZ 400000
+#define BENCH_SPI_HZ 10000000
+#define BENCH_SLOW_CLOCK_PPM 20000 // Sensor clock 2% slow, forced reads come too early
+#define ORDER_BURSTS 3000 // 1 to 3 new fields each, the 8-bit meas_index wraps at every field position
+
+#define PROFILE_LEN 10
+
+typedef struct
+{
+    const char *name;
+    enum bme68x_intf intf;
+    uint8_t op_mode;
+    bool new_data; // bme68x_get_new_data instead of bme68x_get_data
+    int32_t clock_error_ppm;
+    uint8_t poll_steps; // Shortest profile steps between polls, 0 polls every half step
+    bool field_ring;    // Read one field at a time on the field_ring schedule of main.c
+} bench_case_t;
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t empty_polls;
+    uint32_t multi_polls; // Polls returning more than one new field
+    uint32_t failures;
+    bool have_last;
+    uint8_t last_meas_index;
+    uint8_t last_gas_index;
+} bench_result_t;
+
+// Calibration written to the simulated sensor, read back by bme68x_init
+static const struct bme68x_calib_data bench_calib = {
+    .par_h1 = 742, .par_h2 = 1020, .par_h3 = 0, .par_h4 = 45, .par_h5 = 20, .par_h6 = 120, .par_h7 = -100,
+    .par_gh1 = -30, .par_gh2 = -10542, .par_gh3 = 18,
+    .par_t1 = 26286, .par_t2 = 26364, .par_t3 = 3,
+    .par_p1 = 36504, .par_p2 = -10350, .par_p3 = 88, .par_p4 = 7171, .par_p5 = -183, .par_p6 = 30, .par_p7 = 50,
+    .par_p8 = -3176, .par_p9 = -2690, .par_p10 = 30,
+    .res_heat_range = 1, .res_heat_val = 40, .range_sw_err = -3,
+};
+
+// The 3 step cases let 2 or 3 fields complete between polls, four consecutive steps of the
+// profiles are always longer than three of the shortest so no field is overwritten unread
+static const bench_case_t cases[] = {
+    {"forced i2c", BME68X_I2C_INTF, BME68X_FORCED_MODE, false, 0, 0, false},
+    {"forced spi", BME68X_SPI_INTF, BME68X_FORCED_MODE, false, 0, 0, false},
+    {"forced slow", BME68X_I2C_INTF, BME68X_FORCED_MODE, false, BENCH_SLOW_CLOCK_PPM, 0, false},
+    {"parallel i2c", BME68X_I2C_INTF, BME68X_PARALLEL_MODE, false, 0, 0, false},
+    {"parallel spi", BME68X_SPI_INTF, BME68X_PARALLEL_MODE, false, 0, 0, false},
+    {"parallel new", BME68X_I2C_INTF, BME68X_PARALLEL_MODE, true, 0, 0, false},
+    {"parallel 3st", BME68X_I2C_INTF, BME68X_PARALLEL_MODE, false, 0, 3, false},
+    {"parallel 3new", BME68X_I2C_INTF, BME68X_PARALLEL_MODE, true, 0, 3, false},
+    {"event i2c", BME68X_I2C_INTF, BME68X_PARALLEL_MODE, false, 0, 0, true},
+    {"event spi", BME68X_SPI_INTF, BME68X_PARALLEL_MODE, false, 0, 0, true},
+    {"event slow", BME68X_I2C_INTF, BME68X_PARALLEL_MODE, false, BENCH_SLOW_CLOCK_PPM, 0, true},
+    {"event fast", BME68X_I2C_INTF, BME68X_PARALLEL_MODE, false, -BENCH_SLOW_CLOCK_PPM, 0, true},
+    {"sequent i2c", BME68X_I2C_INTF, BME68X_SEQUENTIAL_MODE, false, 0, 0, false},
+    {"sequent spi", BME68X_SPI_INTF, BME68X_SEQUENTIAL_MODE, false, 0, 0, false},
+    {"sequent new", BME68X_SPI_INTF, BME68X_SEQUENTIAL_MODE, true, 0, 0, false},
+    {"sequent 3st", BME68X_SPI_INTF, BME68X_SEQUENTIAL_MODE, false, 0, 3, false},
+    {"sequent 3new", BME68X_SPI_INTF, BME68X_SEQUENTIAL_MODE, true, 0, 3, false},
+};
+
+// Heater profile, durations in ms for sequential mode and multiples of the shared duration in parallel mode
+static uint16_t temp_prof[PROFILE_LEN] = {200, 240, 280, 320, 360, 360, 320, 280, 240, 200};
+static uint16_t dur_prof[PROFILE_LEN] = {5, 2, 10, 30, 5, 5, 5, 5, 5, 5};
+static uint16_t mul_prof[PROFILE_LEN] = {5, 2, 10, 30, 5, 5, 5, 5, 5, 5};
+
+static struct bme68x_sim sim;
+static struct bme68x_dev dev;
+static bench_result_t result;
+
+#define FAIL(...)                  \
+    do                             \
+    {                              \
+        printf("  FAIL: ");        \
+        printf(__VA_ARGS__);       \
+        printf("\n");              \
+        result.failures++;         \
+    } while (0)
+
+#define CHECK_CALIB(field)                                                  \
+    if (dev.calib.field != bench_calib.field)                              \
+    FAIL("calib " #field " %d, expected %d", (int)dev.calib.field, (int)bench_calib.field)
+
+static double wall_time_s()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void check_rslt(const char *api, int8_t rslt)
+{
+    if (rslt != BME68X_OK)
+        FAIL("%s returned %d", api, rslt);
+}
+
+static void check_calib()
+{
+    CHECK_CALIB(par_t1);
+    CHECK_CALIB(par_t2);
+    CHECK_CALIB(par_t3);
+    CHECK_CALIB(par_p1);
+    CHECK_CALIB(par_p2);
+    CHECK_CALIB(par_p3);
+    CHECK_CALIB(par_p4);
+    CHECK_CALIB(par_p5);
+    CHECK_CALIB(par_p6);
+    CHECK_CALIB(par_p7);
+    CHECK_CALIB(par_p8);
+    CHECK_CALIB(par_p9);
+    CHECK_CALIB(par_p10);
+    CHECK_CALIB(par_h1);
+    CHECK_CALIB(par_h2);
+    CHECK_CALIB(par_h3);
+    CHECK_CALIB(par_h4);
+    CHECK_CALIB(par_h5);
+    CHECK_CALIB(par_h6);
+    CHECK_CALIB(par_h7);
+    CHECK_CALIB(par_gh1);
+    CHECK_CALIB(par_gh2);
+    CHECK_CALIB(par_gh3);
+    CHECK_CALIB(res_heat_range);
+    CHECK_CALIB(res_heat_val);
+    CHECK_CALIB(range_sw_err);
+}
+
+// Every sample must be new, follow the previous one without a gap or repeat and carry the heater
+// settings of its profile step
+static void check_sample(const bench_case_t *c, const struct bme68x_data *data)
+{
+    uint8_t steps = (c->op_mode == BME68X_FORCED_MODE) ? 1 : PROFILE_LEN;
+    uint8_t step = data->gas_index;
+
+    if (!(data->status & BME68X_NEW_DATA_MSK))
+        FAIL("sample %lu without new data", (unsigned long)result.samples);
+    if (!(data->status & BME68X_GASM_VALID_MSK) || !(data->status & BME68X_HEAT_STAB_MSK))
+        FAIL("sample %lu status 0x%02x, gas not valid or heater not stable", (unsigned long)result.samples, data->status);
+    if (result.have_last)
+    {
+        if (data->meas_index != (uint8_t)(result.last_meas_index + 1))
+            FAIL("meas_index %u after %u", data->meas_index, result.last_meas_index);
+        if (step != (result.last_gas_index + 1) % steps)
+            FAIL("gas_index %u after %u", step, result.last_gas_index);
+    }
+    if (step >= BME68X_N_HEATR_STEPS ||
+        data->res_heat != sim.regs[BME68X_REG_RES_HEAT0 + step] ||
+        data->idac != sim.regs[BME68X_REG_IDAC_HEAT0 + step] ||
+        data->gas_wait != sim.regs[BME68X_REG_GAS_WAIT0 + step])
+    {
+        FAIL("heater settings of step %u do not match the sensor", step);
+    }
+
+    result.have_last = true;
+    result.last_meas_index = data->meas_index;
+    result.last_gas_index = step;
+    result.samples++;
+}
+
+// Parallel mode through the field_ring schedule, sleeps until the next field is due like main.c
+static void run_field_ring(const bench_case_t *c, struct bme68x_conf *conf, const struct bme68x_heatr_conf *heatr_conf)
+{
+    struct field_ring ring;
+    struct bme68x_data data;
+    uint32_t delay_us = field_ring_init(&ring, bme68x_get_meas_dur(c->op_mode, conf, &dev), heatr_conf);
+
+    while (result.samples < BENCH_SAMPLES && result.failures < 10)
+    {
+        dev.delay_us(delay_us, dev.intf_ptr);
+        if (field_ring_poll(&ring, &data, &delay_us, &dev))
+            check_sample(c, &data);
+        else
+            result.empty_polls++;
+    }
+
+    // Without bus errors the schedule must never lose the ring
+    if (ring.resyncs)
+        FAIL("%lu resyncs", (unsigned long)ring.resyncs);
+}
+
+static int8_t get_data(const bench_case_t *c, struct bme68x_data *data, uint8_t *n_data)
+{
+    if (c->new_data)
+        return bme68x_get_new_data(c->op_mode, data, n_data, &dev);
+
+    return bme68x_get_data(c->op_mode, data, n_data, &dev);
+}
+
+static void run_case(const bench_case_t *c)
+{
+    struct bme68x_conf conf;
+    struct bme68x_heatr_conf heatr_conf = {0};
+    struct bme68x_data data[3];
+    uint8_t n_data;
+    uint32_t poll_us;
+    uint32_t step_us = 0;
+    int8_t rslt;
+
+    result = (bench_result_t){0};
+    bme68x_sim_init(&sim, c->intf, BME68X_VARIANT_GAS_LOW, &bench_calib);
+    sim.bus_hz = (c->intf == BME68X_I2C_INTF) ? BENCH_I2C_HZ : BENCH_SPI_HZ;
+    sim.clock_error_ppm = c->clock_error_ppm;
+    dev = (struct bme68x_dev){0};
+    bme68x_sim_attach(&sim, &dev);
+
+    check_rslt("bme68x_init", bme68x_init(&dev));
+    check_calib();
+
+    check_rslt("bme68x_get_conf", bme68x_get_conf(&conf, &dev));
+    conf.filter = BME68X_FILTER_OFF;
+    conf.odr = BME68X_ODR_NONE;
+    conf.os_hum = BME68X_OS_1X;
+    conf.os_pres = BME68X_OS_16X;
+    conf.os_temp = BME68X_OS_2X;
+    check_rslt("bme68x_set_conf", bme68x_set_conf(&conf, &dev));
+
+    heatr_conf.enable = BME68X_ENABLE;
+    if (c->op_mode == BME68X_FORCED_MODE)
+    {
+        heatr_conf.heatr_temp = 300;
+        heatr_conf.heatr_dur = 100;
+        poll_us = bme68x_get_meas_dur(c->op_mode, &conf, &dev) + heatr_conf.heatr_dur * 1000;
+    }
+    else if (c->op_mode == BME68X_PARALLEL_MODE)
+    {
+        heatr_conf.heatr_temp_prof = temp_prof;
+        heatr_conf.heatr_dur_prof = mul_prof;
+        heatr_conf.shared_heatr_dur = 2;
+        heatr_conf.profile_len = PROFILE_LEN;
+        step_us = bme68x_get_meas_dur(c->op_mode, &conf, &dev) + 2 * heatr_conf.shared_heatr_dur * 1000;
+    }
+    else
+    {
+        heatr_conf.heatr_temp_prof = temp_prof;
+        heatr_conf.heatr_dur_prof = dur_prof;
+        heatr_conf.profile_len = PROFILE_LEN;
+        step_us = bme68x_get_meas_dur(c->op_mode, &conf, &dev) + 2 * 1000;
+    }
+
+    // Shortest step from the profiles, half of it lets at most one measurement complete between polls
+    if (c->op_mode != BME68X_FORCED_MODE)
+        poll_us = c->poll_steps ? c->poll_steps * step_us : step_us / 2;
+    check_rslt("bme68x_set_heatr_conf", bme68x_set_heatr_conf(c->op_mode, &heatr_conf, &dev));
+
+    if (result.failures)
+    {
+        printf("%-13s setup failed\n", c->name);
+        return;
+    }
+
+    if (c->op_mode != BME68X_FORCED_MODE)
+        check_rslt("bme68x_set_op_mode", bme68x_set_op_mode(c->op_mode, &dev));
+
+    uint64_t start_us = sim.now_us;
+    uint32_t start_transactions = sim.transactions;
+    uint32_t start_bytes = sim.bytes;
+    double start = wall_time_s();
+
+    if (c->field_ring)
+        run_field_ring(c, &conf, &heatr_conf);
+
+    bool measuring = false;
+    uint32_t delay_us = poll_us;
+    while (result.samples < BENCH_SAMPLES && result.failures < 10)
+    {
+        if (c->op_mode == BME68X_FORCED_MODE && !measuring)
+        {
+            check_rslt("bme68x_set_op_mode", bme68x_set_op_mode(c->op_mode, &dev));
+            measuring = true;
+            delay_us = poll_us;
+        }
+
+        dev.delay_us(delay_us, dev.intf_ptr);
+        rslt = get_data(c, data, &n_data);
+        if (rslt == BME68X_W_NO_NEW_DATA)
+        {
+            // A forced measurement that is not done yet is read again, not restarted
+            if (c->op_mode == BME68X_FORCED_MODE)
+                delay_us = BME68X_PERIOD_POLL;
+            result.empty_polls++;
+            continue;
+        }
+        check_rslt("get data", rslt);
+        measuring = false;
+        if (n_data > 1)
+            result.multi_polls++;
+
+        for (uint8_t i = 0; i < n_data; i++)
+            check_sample(c, &data[i]);
+    }
+
+    double elapsed = wall_time_s() - start;
+    if (c->poll_steps > 1 && result.multi_polls == 0)
+        FAIL("no poll returned more than one field");
+    if (c->op_mode != BME68X_FORCED_MODE)
+        check_rslt("bme68x_set_op_mode", bme68x_set_op_mode(BME68X_SLEEP_MODE, &dev));
+
+    printf("%-13s %10.0f %9.1f %7lu %7lu %8.2f %8.1f %s\n",
+           c->name, result.samples / elapsed, (sim.now_us - start_us) / 1e6, (unsigned long)result.empty_polls,
+           (unsigned long)result.multi_polls,
+           (double)(sim.transactions - start_transactions) / result.samples,
+           (double)(sim.bytes - start_bytes) / result.samples,
+           result.failures ? "FAIL" : "ok");
+}
+
+// bme68x_get_new_data against bme68x_get_data on the same field registers, with 1 to 3 new fields
+// per burst as the sensor fills its ring. The ordering of bme68x_get_new_data only holds for
+// meas_index values that follow the ring, so the fields are filled by the simulated sensor.
+static bool check_new_data_order()
+{
+    struct bme68x_conf conf;
+    struct bme68x_heatr_conf heatr_conf = {0};
+    struct bme68x_data expected[3];
+    struct bme68x_data data[3];
+    uint8_t fields[BME68X_LEN_FIELD_OFFSET * BME68X_N_FIELDS];
+    uint8_t n_expected, n_data;
+    uint32_t multi = 0;
+
+    result = (bench_result_t){0};
+    bme68x_sim_init(&sim, BME68X_I2C_INTF, BME68X_VARIANT_GAS_LOW, &bench_calib);
+    dev = (struct bme68x_dev){0};
+    bme68x_sim_attach(&sim, &dev);
+
+    check_rslt("bme68x_init", bme68x_init(&dev));
+    check_rslt("bme68x_get_conf", bme68x_get_conf(&conf, &dev));
+    conf.os_hum = BME68X_OS_1X;
+    conf.os_pres = BME68X_OS_1X;
+    conf.os_temp = BME68X_OS_1X;
+    check_rslt("bme68x_set_conf", bme68x_set_conf(&conf, &dev));
+    heatr_conf.enable = BME68X_ENABLE;
+    heatr_conf.heatr_temp_prof = temp_prof;
+    heatr_conf.heatr_dur_prof = mul_prof;
+    heatr_conf.shared_heatr_dur = 2;
+    heatr_conf.profile_len = PROFILE_LEN;
+    check_rslt("bme68x_set_heatr_conf", bme68x_set_heatr_conf(BME68X_PARALLEL_MODE, &heatr_conf, &dev));
+    check_rslt("bme68x_set_op_mode", bme68x_set_op_mode(BME68X_PARALLEL_MODE, &dev));
+
+    for (uint32_t burst = 0; burst < ORDER_BURSTS && result.failures < 10; burst++)
+    {
+        // Complete exactly 1, 2 or 3 measurements, the reads below take no virtual time
+        for (uint32_t i = 0; i <= burst % 3; i++)
+            bme68x_sim_advance(&sim, sim.done_us - sim.now_us);
+
+        // Reading clears the new data bits, both APIs get the same registers
+        memcpy(fields, &sim.regs[BME68X_REG_FIELD0], sizeof(fields));
+        int8_t rslt = bme68x_get_data(BME68X_PARALLEL_MODE, expected, &n_expected, &dev);
+        memcpy(&sim.regs[BME68X_REG_FIELD0], fields, sizeof(fields));
+        int8_t new_rslt = bme68x_get_new_data(BME68X_PARALLEL_MODE, data, &n_data, &dev);
+
+        if (rslt != new_rslt || n_expected != n_data || n_data != burst % 3 + 1)
+        {
+            FAIL("burst %lu: %u fields returned %d, bme68x_get_data %u fields returned %d",
+                 (unsigned long)burst, n_data, new_rslt, n_expected, rslt);
+            continue;
+        }
+        if (n_data > 1)
+            multi++;
+
+        for (uint8_t i = 0; i < n_data; i++)
+        {
+            if (data[i].meas_index != expected[i].meas_index || data[i].gas_index != expected[i].gas_index ||
+                data[i].status != expected[i].status || data[i].res_heat != expected[i].res_heat ||
+                data[i].temperature != expected[i].temperature || data[i].pressure != expected[i].pressure ||
+                data[i].humidity != expected[i].humidity || data[i].gas_resistance != expected[i].gas_resistance)
+            {
+                FAIL("burst %lu field %u: meas_index %u, bme68x_get_data meas_index %u",
+                     (unsigned long)burst, i, data[i].meas_index, expected[i].meas_index);
+            }
+        }
+    }
+
+    check_rslt("bme68x_set_op_mode", bme68x_set_op_mode(BME68X_SLEEP_MODE, &dev));
+    printf("new data order: %lu bursts, %lu with 2 or 3 new fields, %s\n",
+           (unsigned long)ORDER_BURSTS, (unsigned long)multi, result.failures ? "FAIL" : "ok");
+    return result.failures == 0;
+}
+
+int main()
+{
+    uint32_t failed = 0;
+
+#ifdef BME68X_USE_FPU
+    printf("BME68X host benchmark, float compensation, %d samples per case\n", BENCH_SAMPLES);
+#else
+    printf("BME68X host benchmark, integer compensation, %d samples per case\n", BENCH_SAMPLES);
+#endif
+    printf("%-13s %10s %9s %7s %7s %8s %8s\n", "case", "samples/s", "virtual s", "empty", "multi", "xfers", "bytes");
+
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        run_case(&cases[i]);
+        if (result.failures)
+            failed++;
+    }
+
+    if (!check_new_data_order())
+        failed++;
+
+    printf("%lu of %lu cases failed\n", (unsigned long)failed, (unsigned long)(sizeof(cases) / sizeof(cases[0]) + 1));
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
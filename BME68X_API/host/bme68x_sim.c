@@ -0,0 +1,361 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "bme68x_sim.h"
+
+/* Field registers of the sensor */
+#define SIM_FIELD_STATUS 0
+#define SIM_FIELD_MEAS_INDEX 1
+#define SIM_FIELD_PRES 2
+#define SIM_FIELD_TEMP 5
+#define SIM_FIELD_HUM 8
+#define SIM_FIELD_GAS_L 13
+#define SIM_FIELD_GAS_H 15
+
+/* SPI register that maps to the status register on both memory pages */
+#define SIM_SPI_REG_STATUS UINT8_C(0x73)
+
+/* Sequential mode standby time per ODR setting in microseconds */
+static const uint32_t sim_odr_us[8] = {590, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+
+/* Oversampling setting to measurement cycles */
+static const uint8_t sim_os_cycles[8] = {0, 1, 2, 4, 8, 16, 16, 16};
+
+static void reset_regs(struct bme68x_sim *sim);
+static void write_calib(struct bme68x_sim *sim, const struct bme68x_calib_data *calib);
+static void start_measurement(struct bme68x_sim *sim);
+static void complete_measurement(struct bme68x_sim *sim);
+static uint64_t measurement_us(const struct bme68x_sim *sim);
+static uint8_t map_addr(const struct bme68x_sim *sim, uint8_t reg_addr);
+static void write_reg(struct bme68x_sim *sim, uint8_t addr, uint8_t value);
+static void bus_transfer(struct bme68x_sim *sim, uint32_t len);
+
+void bme68x_sim_init(struct bme68x_sim *sim,
+                     enum bme68x_intf intf,
+                     uint8_t variant_id,
+                     const struct bme68x_calib_data *calib)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->intf = intf;
+    sim->temp_adc = 480000;
+    sim->pres_adc = 400000;
+    sim->hum_adc = 20000;
+    sim->gas_adc = 512;
+    sim->gas_range = 8;
+
+    sim->regs[BME68X_REG_CHIP_ID] = BME68X_CHIP_ID;
+    sim->regs[BME68X_REG_VARIANT_ID] = variant_id;
+    write_calib(sim, calib);
+    reset_regs(sim);
+}
+
+void bme68x_sim_attach(struct bme68x_sim *sim, struct bme68x_dev *dev)
+{
+    dev->read = bme68x_sim_read;
+    dev->write = bme68x_sim_write;
+    dev->delay_us = bme68x_sim_delay_us;
+    dev->intf = sim->intf;
+    dev->intf_ptr = sim;
+    dev->amb_temp = 25;
+}
+
+void bme68x_sim_advance(struct bme68x_sim *sim, uint64_t period)
+{
+    sim->now_us += period;
+    while ((sim->mode != BME68X_SLEEP_MODE) && (sim->now_us >= sim->done_us))
+    {
+        complete_measurement(sim);
+    }
+}
+
+BME68X_INTF_RET_TYPE bme68x_sim_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr)
+{
+    struct bme68x_sim *sim = (struct bme68x_sim *)intf_ptr;
+    uint8_t addr;
+
+    bus_transfer(sim, len);
+    for (uint32_t i = 0; i < len; i++)
+    {
+        addr = map_addr(sim, (uint8_t)(reg_addr + i));
+        reg_data[i] = sim->regs[addr];
+
+        /* Reading the status byte of a field clears its new data bit */
+        if ((addr >= BME68X_REG_FIELD0) && (addr < BME68X_REG_FIELD0 + BME68X_LEN_FIELD * BME68X_N_FIELDS) &&
+            ((addr - BME68X_REG_FIELD0) % BME68X_LEN_FIELD_OFFSET == SIM_FIELD_STATUS))
+        {
+            sim->regs[addr] &= (uint8_t)~BME68X_NEW_DATA_MSK;
+        }
+    }
+
+    return BME68X_OK;
+}
+
+BME68X_INTF_RET_TYPE bme68x_sim_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr)
+{
+    struct bme68x_sim *sim = (struct bme68x_sim *)intf_ptr;
+
+    /* Address and data pairs, the first address is passed separately */
+    bus_transfer(sim, len);
+    write_reg(sim, map_addr(sim, reg_addr), reg_data[0]);
+    for (uint32_t i = 1; i + 1 < len; i += 2)
+    {
+        write_reg(sim, map_addr(sim, reg_data[i]), reg_data[i + 1]);
+    }
+
+    return BME68X_OK;
+}
+
+void bme68x_sim_delay_us(uint32_t period, void *intf_ptr)
+{
+    bme68x_sim_advance((struct bme68x_sim *)intf_ptr, period);
+}
+
+/* Registers that a soft reset returns to their reset values, the NVM content is kept */
+static void reset_regs(struct bme68x_sim *sim)
+{
+    memset(&sim->regs[BME68X_REG_FIELD0], 0, BME68X_REG_CTRL_GAS_0 - BME68X_REG_FIELD0);
+    memset(&sim->regs[BME68X_REG_CTRL_GAS_0], 0, BME68X_REG_CONFIG - BME68X_REG_CTRL_GAS_0 + 1);
+    sim->regs[BME68X_REG_MEM_PAGE] = 0;
+    sim->mode = BME68X_SLEEP_MODE;
+    sim->step = 0;
+    sim->meas_count = 0;
+}
+
+/* The inverse of get_calib_data in bme68x.c */
+static void write_calib(struct bme68x_sim *sim, const struct bme68x_calib_data *calib)
+{
+    uint8_t coeff[BME68X_LEN_COEFF_ALL] = {0};
+
+    coeff[BME68X_IDX_T1_LSB] = (uint8_t)calib->par_t1;
+    coeff[BME68X_IDX_T1_MSB] = (uint8_t)(calib->par_t1 >> 8);
+    coeff[BME68X_IDX_T2_LSB] = (uint8_t)calib->par_t2;
+    coeff[BME68X_IDX_T2_MSB] = (uint8_t)((uint16_t)calib->par_t2 >> 8);
+    coeff[BME68X_IDX_T3] = (uint8_t)calib->par_t3;
+
+    coeff[BME68X_IDX_P1_LSB] = (uint8_t)calib->par_p1;
+    coeff[BME68X_IDX_P1_MSB] = (uint8_t)(calib->par_p1 >> 8);
+    coeff[BME68X_IDX_P2_LSB] = (uint8_t)calib->par_p2;
+    coeff[BME68X_IDX_P2_MSB] = (uint8_t)((uint16_t)calib->par_p2 >> 8);
+    coeff[BME68X_IDX_P3] = (uint8_t)calib->par_p3;
+    coeff[BME68X_IDX_P4_LSB] = (uint8_t)calib->par_p4;
+    coeff[BME68X_IDX_P4_MSB] = (uint8_t)((uint16_t)calib->par_p4 >> 8);
+    coeff[BME68X_IDX_P5_LSB] = (uint8_t)calib->par_p5;
+    coeff[BME68X_IDX_P5_MSB] = (uint8_t)((uint16_t)calib->par_p5 >> 8);
+    coeff[BME68X_IDX_P6] = (uint8_t)calib->par_p6;
+    coeff[BME68X_IDX_P7] = (uint8_t)calib->par_p7;
+    coeff[BME68X_IDX_P8_LSB] = (uint8_t)calib->par_p8;
+    coeff[BME68X_IDX_P8_MSB] = (uint8_t)((uint16_t)calib->par_p8 >> 8);
+    coeff[BME68X_IDX_P9_LSB] = (uint8_t)calib->par_p9;
+    coeff[BME68X_IDX_P9_MSB] = (uint8_t)((uint16_t)calib->par_p9 >> 8);
+    coeff[BME68X_IDX_P10] = calib->par_p10;
+
+    /* H1 and H2 share the middle byte */
+    coeff[BME68X_IDX_H1_MSB] = (uint8_t)(calib->par_h1 >> 4);
+    coeff[BME68X_IDX_H2_MSB] = (uint8_t)(calib->par_h2 >> 4);
+    coeff[BME68X_IDX_H1_LSB] = (uint8_t)((calib->par_h1 & BME68X_BIT_H1_DATA_MSK) | ((calib->par_h2 & 0x0f) << 4));
+    coeff[BME68X_IDX_H3] = (uint8_t)calib->par_h3;
+    coeff[BME68X_IDX_H4] = (uint8_t)calib->par_h4;
+    coeff[BME68X_IDX_H5] = (uint8_t)calib->par_h5;
+    coeff[BME68X_IDX_H6] = calib->par_h6;
+    coeff[BME68X_IDX_H7] = (uint8_t)calib->par_h7;
+
+    coeff[BME68X_IDX_GH1] = (uint8_t)calib->par_gh1;
+    coeff[BME68X_IDX_GH2_LSB] = (uint8_t)calib->par_gh2;
+    coeff[BME68X_IDX_GH2_MSB] = (uint8_t)((uint16_t)calib->par_gh2 >> 8);
+    coeff[BME68X_IDX_GH3] = (uint8_t)calib->par_gh3;
+
+    coeff[BME68X_IDX_RES_HEAT_VAL] = (uint8_t)calib->res_heat_val;
+    coeff[BME68X_IDX_RES_HEAT_RANGE] = (uint8_t)((calib->res_heat_range * 16) & BME68X_RHRANGE_MSK);
+    coeff[BME68X_IDX_RANGE_SW_ERR] = (uint8_t)((calib->range_sw_err * 16) & BME68X_RSERROR_MSK);
+
+    memcpy(&sim->regs[BME68X_REG_COEFF1], coeff, BME68X_LEN_COEFF1);
+    memcpy(&sim->regs[BME68X_REG_COEFF2], &coeff[BME68X_LEN_COEFF1], BME68X_LEN_COEFF2);
+    memcpy(&sim->regs[BME68X_REG_COEFF3], &coeff[BME68X_LEN_COEFF1 + BME68X_LEN_COEFF2], BME68X_LEN_COEFF3);
+}
+
+/* SPI addresses are 7 bit, the memory page supplies the top bit */
+static uint8_t map_addr(const struct bme68x_sim *sim, uint8_t reg_addr)
+{
+    if (sim->intf == BME68X_I2C_INTF)
+    {
+        return reg_addr;
+    }
+
+    reg_addr &= BME68X_SPI_WR_MSK;
+    if (reg_addr == SIM_SPI_REG_STATUS)
+    {
+        return BME68X_REG_MEM_PAGE;
+    }
+
+    if (sim->regs[BME68X_REG_MEM_PAGE] & BME68X_MEM_PAGE_MSK)
+    {
+        return reg_addr;
+    }
+
+    return (uint8_t)(reg_addr | 0x80);
+}
+
+static void write_reg(struct bme68x_sim *sim, uint8_t addr, uint8_t value)
+{
+    switch (addr)
+    {
+    case BME68X_REG_SOFT_RESET:
+        if (value == BME68X_SOFT_RESET_CMD)
+        {
+            reset_regs(sim);
+        }
+
+        break;
+    case BME68X_REG_CHIP_ID:
+    case BME68X_REG_VARIANT_ID:
+        break;
+    case BME68X_REG_CTRL_MEAS:
+        sim->regs[addr] = value;
+        if ((value & BME68X_MODE_MSK) == BME68X_SLEEP_MODE)
+        {
+            sim->mode = BME68X_SLEEP_MODE;
+        }
+        else if (sim->mode == BME68X_SLEEP_MODE)
+        {
+            sim->mode = value & BME68X_MODE_MSK;
+            sim->step = 0;
+            start_measurement(sim);
+        }
+
+        break;
+    default:
+        sim->regs[addr] = value;
+        break;
+    }
+}
+
+static bool gas_enabled(const struct bme68x_sim *sim)
+{
+    return (sim->regs[BME68X_REG_CTRL_GAS_1] & BME68X_RUN_GAS_MSK) != 0;
+}
+
+static bool heater_enabled(const struct bme68x_sim *sim)
+{
+    return (sim->regs[BME68X_REG_CTRL_GAS_0] & BME68X_HCTRL_MSK) == 0;
+}
+
+/* Heater duration in microseconds from a gas_wait or shared heater duration register */
+static uint64_t heater_us(uint8_t reg, uint32_t step_us)
+{
+    return (uint64_t)(reg & 0x3f) * ((uint32_t)1 << (2 * (reg >> 6))) * step_us;
+}
+
+/* Duration of one measurement, the same timing that bme68x_get_meas_dur assumes */
+static uint64_t measurement_us(const struct bme68x_sim *sim)
+{
+    uint8_t ctrl_meas = sim->regs[BME68X_REG_CTRL_MEAS];
+    uint8_t gas_wait = sim->regs[BME68X_REG_GAS_WAIT0 + sim->step];
+    uint8_t odr = BME68X_GET_BITS(sim->regs[BME68X_REG_CONFIG], BME68X_ODR20);
+    uint32_t meas_cycles;
+    uint64_t duration;
+
+    meas_cycles = sim_os_cycles[BME68X_GET_BITS(ctrl_meas, BME68X_OST)];
+    meas_cycles += sim_os_cycles[BME68X_GET_BITS(ctrl_meas, BME68X_OSP)];
+    meas_cycles += sim_os_cycles[BME68X_GET_BITS_POS_0(sim->regs[BME68X_REG_CTRL_HUM], BME68X_OSH)];
+    duration = meas_cycles * UINT32_C(1963) + UINT32_C(477 * 4) + UINT32_C(477 * 5);
+
+    if (sim->mode == BME68X_PARALLEL_MODE)
+    {
+        /* gas_wait holds the multiplier of the shared heater duration */
+        if (gas_enabled(sim))
+        {
+            duration += gas_wait * heater_us(sim->regs[BME68X_REG_SHD_HEATR_DUR], 477);
+        }
+    }
+    else
+    {
+        duration += 1000;
+        if (gas_enabled(sim))
+        {
+            duration += heater_us(gas_wait, 1000);
+        }
+
+        if ((sim->mode == BME68X_SEQUENTIAL_MODE) && !(sim->regs[BME68X_REG_CTRL_GAS_1] & BME68X_ODR3_MSK))
+        {
+            duration += sim_odr_us[odr];
+        }
+    }
+
+    return duration + (int64_t)duration * sim->clock_error_ppm / 1000000;
+}
+
+static void start_measurement(struct bme68x_sim *sim)
+{
+    /* A forced measurement reuses field 0, its old data is no longer new */
+    if (sim->mode == BME68X_FORCED_MODE)
+    {
+        sim->regs[BME68X_REG_FIELD0] &= (uint8_t)~BME68X_NEW_DATA_MSK;
+    }
+
+    sim->done_us = sim->now_us + measurement_us(sim);
+}
+
+static void complete_measurement(struct bme68x_sim *sim)
+{
+    uint8_t nb_conv = BME68X_GET_BITS_POS_0(sim->regs[BME68X_REG_CTRL_GAS_1], BME68X_NBCONV);
+    uint8_t field = (sim->mode == BME68X_FORCED_MODE) ? 0 : (uint8_t)(sim->meas_count % BME68X_N_FIELDS);
+    uint8_t gas_index = (sim->mode == BME68X_FORCED_MODE) ? 0 : sim->step;
+    uint8_t *f = &sim->regs[BME68X_REG_FIELD0 + field * BME68X_LEN_FIELD_OFFSET];
+    int32_t jitter = (int32_t)((sim->meas_count * 37) % 64) - 32;
+    uint32_t temp_adc = (uint32_t)((int32_t)sim->temp_adc + jitter * 16);
+    uint32_t pres_adc = (uint32_t)((int32_t)sim->pres_adc + jitter * 16);
+    uint16_t hum_adc = (uint16_t)(sim->hum_adc + jitter);
+    uint16_t gas_adc = (uint16_t)((sim->gas_adc + (uint16_t)jitter) & 0x3ff);
+    uint8_t gas_status = sim->gas_range & BME68X_GAS_RANGE_MSK;
+
+    if (gas_enabled(sim))
+    {
+        gas_status |= BME68X_GASM_VALID_MSK;
+        if (heater_enabled(sim) && sim->regs[BME68X_REG_RES_HEAT0 + gas_index])
+        {
+            gas_status |= BME68X_HEAT_STAB_MSK;
+        }
+    }
+
+    f[SIM_FIELD_STATUS] = BME68X_NEW_DATA_MSK | (gas_index & BME68X_GAS_INDEX_MSK);
+    f[SIM_FIELD_MEAS_INDEX] = (uint8_t)sim->meas_count;
+    f[SIM_FIELD_PRES] = (uint8_t)(pres_adc >> 12);
+    f[SIM_FIELD_PRES + 1] = (uint8_t)(pres_adc >> 4);
+    f[SIM_FIELD_PRES + 2] = (uint8_t)(pres_adc << 4);
+    f[SIM_FIELD_TEMP] = (uint8_t)(temp_adc >> 12);
+    f[SIM_FIELD_TEMP + 1] = (uint8_t)(temp_adc >> 4);
+    f[SIM_FIELD_TEMP + 2] = (uint8_t)(temp_adc << 4);
+    f[SIM_FIELD_HUM] = (uint8_t)(hum_adc >> 8);
+    f[SIM_FIELD_HUM + 1] = (uint8_t)hum_adc;
+    f[SIM_FIELD_GAS_L] = (uint8_t)(gas_adc >> 2);
+    f[SIM_FIELD_GAS_L + 1] = (uint8_t)((gas_adc << 6) | gas_status);
+    f[SIM_FIELD_GAS_H] = f[SIM_FIELD_GAS_L];
+    f[SIM_FIELD_GAS_H + 1] = f[SIM_FIELD_GAS_L + 1];
+
+    sim->meas_count++;
+
+    if (sim->mode == BME68X_FORCED_MODE)
+    {
+        /* Back to sleep after one measurement */
+        sim->mode = BME68X_SLEEP_MODE;
+        sim->regs[BME68X_REG_CTRL_MEAS] &= (uint8_t)~BME68X_MODE_MSK;
+    }
+    else
+    {
+        sim->step = (nb_conv > 0) ? (uint8_t)((sim->step + 1) % nb_conv) : 0;
+        sim->done_us += measurement_us(sim);
+    }
+}
+
+/* Transfer time of the register address and data bytes, an I2C byte takes 9 clocks with its acknowledge */
+static void bus_transfer(struct bme68x_sim *sim, uint32_t len)
+{
+    uint32_t clocks = (sim->intf == BME68X_I2C_INTF) ? 9 : 8;
+
+    sim->transactions++;
+    sim->bytes += len + 1;
+    if (sim->bus_hz)
+    {
+        bme68x_sim_advance(sim, (uint64_t)(len + 1) * clocks * 1000000 / sim->bus_hz);
+    }
+}
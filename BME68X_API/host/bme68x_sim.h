@@ -0,0 +1,112 @@
+#ifndef BME68X_SIM_H_
+#define BME68X_SIM_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /*__cplusplus */
+
+#include "bme68x.h"
+
+    /*!
+     *  @brief Simulated BME68X for running the driver on a host. The register map is kept in the
+     *  I2C address space, SPI accesses are mapped through the memory page like on the sensor.
+     *  Time only passes through bme68x_sim_delay_us, bme68x_sim_advance and, if bus_hz is set,
+     *  the bus transfers.
+     */
+    struct bme68x_sim
+    {
+        /*! Register map, I2C addresses */
+        uint8_t regs[256];
+
+        /*! Interface the driver uses */
+        enum bme68x_intf intf;
+
+        /*! Virtual time in microseconds */
+        uint64_t now_us;
+
+        /*! Bus clock for the transfer time, 0 makes transfers take no time */
+        uint32_t bus_hz;
+
+        /*! Sensor clock error in ppm, positive makes measurements take longer */
+        int32_t clock_error_ppm;
+
+        /*! Raw values of the next measurements, a small deterministic jitter is added */
+        uint32_t temp_adc;
+        uint32_t pres_adc;
+        uint16_t hum_adc;
+        uint16_t gas_adc;
+        uint8_t gas_range;
+
+        /*! Operation mode being run */
+        uint8_t mode;
+
+        /*! Heater profile step of the measurement being run */
+        uint8_t step;
+
+        /*! Completion time of the measurement being run */
+        uint64_t done_us;
+
+        /*! Measurements completed since the last reset */
+        uint32_t meas_count;
+
+        /*! Bus transactions and bytes, including the register address byte */
+        uint32_t transactions;
+        uint32_t bytes;
+    };
+
+    /*!
+     *  @brief Initializes the simulated sensor in its reset state.
+     *
+     *  @param[out] sim         : Simulated sensor
+     *  @param[in] intf         : Interface the driver uses
+     *  @param[in] variant_id   : BME68X_VARIANT_GAS_LOW or BME68X_VARIANT_GAS_HIGH
+     *  @param[in] calib        : Calibration coefficients written to the coefficient registers
+     *
+     *  @return void.
+     */
+    void bme68x_sim_init(struct bme68x_sim *sim,
+                         enum bme68x_intf intf,
+                         uint8_t variant_id,
+                         const struct bme68x_calib_data *calib);
+
+    /*!
+     *  @brief Points the interface functions of the driver at the simulated sensor.
+     *
+     *  @param[in] sim      : Simulated sensor
+     *  @param[out] dev     : Structure instance of bme68x_dev
+     *
+     *  @return void.
+     */
+    void bme68x_sim_attach(struct bme68x_sim *sim, struct bme68x_dev *dev);
+
+    /*!
+     *  @brief Advances the virtual time and completes the measurements due.
+     *
+     *  @param[in] sim      : Simulated sensor
+     *  @param[in] period   : Time to advance in microseconds
+     *
+     *  @return void.
+     */
+    void bme68x_sim_advance(struct bme68x_sim *sim, uint64_t period);
+
+    /*!
+     *  @brief Read function of the simulated sensor, see bme68x_read_fptr_t.
+     */
+    BME68X_INTF_RET_TYPE bme68x_sim_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+    /*!
+     *  @brief Write function of the simulated sensor, see bme68x_write_fptr_t.
+     */
+    BME68X_INTF_RET_TYPE bme68x_sim_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr);
+
+    /*!
+     *  @brief Delay function of the simulated sensor, advances the virtual time.
+     */
+    void bme68x_sim_delay_us(uint32_t period, void *intf_ptr);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* BME68X_SIM_H_ */
@@ -6,10 +6,14 @@
  */
 
 #include <stdio.h>
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+#include "hardware/sync.h"
 #include "hardware/timer.h"
 
 #include "bme68x.h"
 #include "common.h"
+#include "field_ring.h"
 
 /***********************************************************************/
 /*                         Macros                                      */
@@ -21,8 +25,338 @@
  */
 #define BME68X_VALID_DATA UINT8_C(0xB0)
 
-/* Macro for count of samples to be displayed */
-#define SAMPLE_COUNT UINT8_C(50)
+/* Set to 0 to run the original fixed delay loop, e.g. to compare the statistics */
+#define EVENT_DRIVEN_ACQUISITION 1
+
+/* Fields and reports waiting to be printed by core 1 */
+#define FIELD_QUEUE_LEN 8
+
+/* Interval of the samples/minute and duty cycle report */
+#define REPORT_INTERVAL_MS UINT32_C(60000)
+
+/* Calls averaged by the bme68x_get_data bus cost test */
+#define TEST_GET_DATA_CALLS 10
+
+/***********************************************************************/
+/*                         Types                                       */
+/***********************************************************************/
+
+/* Field handed from the acquisition loop on core 0 to the print task on core 1 */
+struct field_sample
+{
+    struct bme68x_data data;
+    uint32_t time_ms;
+};
+
+/* Statistics of the acquisition loop for the current report interval */
+struct acquisition_stats
+{
+    uint64_t window_start_us;
+    uint64_t busy_us;
+    uint32_t samples;
+    uint32_t duplicates;
+    uint32_t reads;
+    uint32_t misses;
+    uint32_t resyncs;
+    uint32_t queue_drops;
+};
+
+/* Statistics of one report interval, printed by core 1 */
+struct stats_report
+{
+    const char *loop_name;
+    uint64_t window_us;
+    struct acquisition_stats stats;
+    struct bme68x_bus_stats bus;
+};
+
+/* Message from core 0 to the print task on core 1 */
+struct print_message
+{
+    bool is_report;
+    union
+    {
+        struct field_sample field;
+        struct stats_report report;
+    };
+};
+
+/***********************************************************************/
+/*                         Static variables                            */
+/***********************************************************************/
+
+static struct bme68x_dev bme;
+static struct bme68x_conf conf;
+static struct bme68x_heatr_conf heatr_conf;
+
+/* Heater temperature in degree Celsius */
+static uint16_t temp_prof[10] = {320, 100, 100, 100, 200, 200, 200, 320, 320, 320};
+
+/* Multiplier to the shared heater duration */
+static uint16_t mul_prof[10] = {5, 2, 10, 30, 5, 5, 5, 5, 5, 5};
+
+static queue_t field_queue;
+static struct acquisition_stats stats;
+static uint8_t last_meas_index;
+static bool meas_index_valid;
+
+/* Set by the field alarm, the acquisition loop sleeps until it is set */
+static volatile bool field_due;
+
+/***********************************************************************/
+/*                         Static functions                            */
+/***********************************************************************/
+
+/* Print the statistics of one report interval, the float math stays on core 1 too */
+static void print_report(const struct stats_report *report)
+{
+    printf("%s: %.1f samples/min, duty cycle %.3f %%, %lu reads, %lu misses, %lu duplicates, %lu resyncs, %lu queue drops, %lu bus bytes\n",
+           report->loop_name,
+           report->stats.samples * 60e6f / report->window_us,
+           100.0f * report->stats.busy_us / report->window_us,
+           (long unsigned int)report->stats.reads,
+           (long unsigned int)report->stats.misses,
+           (long unsigned int)report->stats.duplicates,
+           (long unsigned int)report->stats.resyncs,
+           (long unsigned int)report->stats.queue_drops,
+           (long unsigned int)report->bus.bytes);
+}
+
+/* Print task on core 1, prints the fields in the order they were acquired and the reports */
+static void print_task(void)
+{
+    struct print_message message;
+    struct field_sample *sample = &message.field;
+    char text[BME68X_DATA_STRING_LEN];
+    uint16_t sample_count = 1;
+
+    while (true)
+    {
+        queue_remove_blocking(&field_queue, &message);
+        if (message.is_report)
+        {
+            print_report(&message.report);
+            continue;
+        }
+
+        if (sample->data.status != BME68X_VALID_DATA)
+        {
+            continue;
+        }
+
+        bme68x_format_data(text, sizeof(text), &sample->data);
+        printf("Sample_count: %u, Time Elapsed: %lu.%03lu s, %s, Status: 0x%x, Gas_index: %d, Meas_index %d\n",
+               sample_count,
+               (long unsigned int)(sample->time_ms / 1000),
+               (long unsigned int)(sample->time_ms % 1000),
+               text,
+               sample->data.status,
+               sample->data.gas_index,
+               sample->data.meas_index);
+        sample_count++;
+    }
+}
+
+/* Queue a field for core 1, a field that was already published or didn't fit in the queue is only counted */
+static void publish_field(const struct bme68x_data *data)
+{
+    struct print_message message;
+
+    if (meas_index_valid && (data->meas_index == last_meas_index))
+    {
+        stats.duplicates++;
+
+        return;
+    }
+
+    last_meas_index = data->meas_index;
+    meas_index_valid = true;
+
+    message.is_report = false;
+    message.field.data = *data;
+    message.field.time_ms = to_ms_since_boot(get_absolute_time());
+    if (queue_try_add(&field_queue, &message))
+    {
+        stats.samples++;
+    }
+    else
+    {
+        /* Core 1 fell behind, the field is lost */
+        stats.queue_drops++;
+    }
+}
+
+/*
+ * Hand the statistics to core 1 once per report interval and start a new one. Printing here
+ * could block the acquisition on the stdio mutex while core 1 prints a field. If the queue is
+ * full the interval is extended and handed over on a later call.
+ */
+static void report_stats(const char *loop_name)
+{
+    struct print_message message;
+    uint64_t now = time_us_64();
+    uint64_t window_us = now - stats.window_start_us;
+
+    if (window_us < (uint64_t)REPORT_INTERVAL_MS * 1000)
+    {
+        return;
+    }
+
+    message.is_report = true;
+    message.report.loop_name = loop_name;
+    message.report.window_us = window_us;
+    message.report.stats = stats;
+    bme68x_get_bus_stats(&message.report.bus);
+    if (!queue_try_add(&field_queue, &message))
+    {
+        return;
+    }
+
+    stats = (struct acquisition_stats){0};
+    stats.window_start_us = now;
+    bme68x_reset_bus_stats();
+}
+
+/* Bus transactions and bytes of one bme68x_get_data and bme68x_get_new_data call in parallel mode */
+static void test_get_data_bus_cost(void)
+{
+    struct bme68x_data data[3];
+    struct bme68x_bus_stats bus;
+    uint8_t n_fields;
+
+    /* The first call also reads the heater settings into the driver cache */
+    bme68x_reset_bus_stats();
+    (void)bme68x_get_data(BME68X_PARALLEL_MODE, data, &n_fields, &bme);
+    bme68x_get_bus_stats(&bus);
+    printf("bme68x_get_data first call: %lu transactions, %lu bytes\n",
+           (long unsigned int)bus.transactions,
+           (long unsigned int)bus.bytes);
+
+    bme68x_reset_bus_stats();
+    for (uint8_t i = 0; i < TEST_GET_DATA_CALLS; i++)
+    {
+        (void)bme68x_get_data(BME68X_PARALLEL_MODE, data, &n_fields, &bme);
+    }
+
+    bme68x_get_bus_stats(&bus);
+    printf("bme68x_get_data per call: %.1f transactions, %.1f bytes\n",
+           (float)bus.transactions / TEST_GET_DATA_CALLS,
+           (float)bus.bytes / TEST_GET_DATA_CALLS);
+
+    bme68x_reset_bus_stats();
+    for (uint8_t i = 0; i < TEST_GET_DATA_CALLS; i++)
+    {
+        (void)bme68x_get_new_data(BME68X_PARALLEL_MODE, data, &n_fields, &bme);
+    }
+
+    bme68x_get_bus_stats(&bus);
+    printf("bme68x_get_new_data per call: %.1f transactions, %.1f bytes\n",
+           (float)bus.transactions / TEST_GET_DATA_CALLS,
+           (float)bus.bytes / TEST_GET_DATA_CALLS);
+}
+
+/* The original loop, sleeps for one shared heater period and reads all fields */
+static void run_delay_loop(void)
+{
+    struct bme68x_data data[3];
+    uint32_t del_period;
+    uint8_t n_fields;
+    uint64_t start;
+    int8_t rslt;
+
+    bme68x_reset_bus_stats();
+    stats.window_start_us = time_us_64();
+    while (true)
+    {
+        /* Calculate delay period in microseconds */
+        del_period = bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, &bme) + (heatr_conf.shared_heatr_dur * 1000);
+        bme.delay_us(del_period, bme.intf_ptr);
+
+        start = time_us_64();
+        rslt = bme68x_get_data(BME68X_PARALLEL_MODE, data, &n_fields, &bme);
+        stats.reads++;
+        if (rslt == BME68X_W_NO_NEW_DATA)
+        {
+            stats.misses++;
+        }
+        else
+        {
+            bme68x_check_rslt("bme68x_get_data", rslt);
+        }
+
+        for (uint8_t i = 0; i < n_fields; i++)
+        {
+            publish_field(&data[i]);
+        }
+
+        stats.busy_us += time_us_64() - start;
+        report_stats("delay loop");
+    }
+}
+
+static int64_t field_alarm_callback(alarm_id_t id, void *user_data)
+{
+    field_due = true;
+    __sev();
+
+    return 0;
+}
+
+/* Arm the field alarm, the hardware alarm wakes the core at the given time */
+static void schedule_field(absolute_time_t time)
+{
+    field_due = false;
+    if (add_alarm_at(time, field_alarm_callback, NULL, true) < 0)
+    {
+        field_due = true;
+    }
+}
+
+/*
+ * Event driven loop. The field_ring schedule knows which field the sensor writes next
+ * and when, one alarm is armed per field, a little before it is written, and the core
+ * sleeps until it fires. Early wakeups read the field again shortly after.
+ */
+static void run_event_loop(void)
+{
+    struct field_ring ring;
+    struct bme68x_data data;
+    uint32_t delay_us;
+    uint64_t start;
+
+    bme68x_reset_bus_stats();
+    stats.window_start_us = time_us_64();
+    delay_us = field_ring_init(&ring, bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, &bme), &heatr_conf);
+    schedule_field(make_timeout_time_us(delay_us));
+    while (true)
+    {
+        while (!field_due)
+        {
+            __wfe();
+        }
+
+        start = time_us_64();
+        field_due = false;
+
+        if (field_ring_poll(&ring, &data, &delay_us, &bme))
+        {
+            publish_field(&data);
+        }
+
+        schedule_field(make_timeout_time_us(delay_us));
+
+        /* Move the counters of the schedule into the report interval */
+        stats.reads += ring.reads;
+        stats.misses += ring.misses;
+        stats.resyncs += ring.resyncs;
+        ring.reads = 0;
+        ring.misses = 0;
+        ring.resyncs = 0;
+
+        stats.busy_us += time_us_64() - start;
+        report_stats("event loop");
+    }
+}
 
 /***********************************************************************/
 /*                         Test code                                   */
@@ -34,21 +368,7 @@ int main(void)
     stdio_init_all();
 
     sleep_ms(3000);
-    struct bme68x_dev bme;
     int8_t rslt;
-    struct bme68x_conf conf;
-    struct bme68x_heatr_conf heatr_conf;
-    struct bme68x_data data[3];
-    uint32_t del_period;
-    uint8_t n_fields;
-    uint32_t time_ms = 0;
-    uint16_t sample_count = 1;
-
-    /* Heater temperature in degree Celsius */
-    uint16_t temp_prof[10] = {320, 100, 100, 100, 200, 200, 200, 320, 320, 320};
-
-    /* Multiplier to the shared heater duration */
-    uint16_t mul_prof[10] = {5, 2, 10, 30, 5, 5, 5, 5, 5, 5};
 
     /* Interface preference is updated as a parameter
      * For I2C : BME68X_I2C_INTF
@@ -85,6 +405,12 @@ int main(void)
     rslt = bme68x_set_heatr_conf(BME68X_PARALLEL_MODE, &heatr_conf, &bme);
     bme68x_check_rslt("bme68x_set_heatr_conf", rslt);
 
+    test_get_data_bus_cost();
+
+    /* Fields are printed on core 1 so printing never delays a read */
+    queue_init(&field_queue, sizeof(struct print_message), FIELD_QUEUE_LEN);
+    multicore_launch_core1(print_task);
+
     /* Check if rslt == BME68X_OK, report or handle if otherwise */
     rslt = bme68x_set_op_mode(BME68X_PARALLEL_MODE, &bme);
     bme68x_check_rslt("bme68x_set_op_mode", rslt);
@@ -95,49 +421,12 @@ int main(void)
     /* Check if rslt == BME68X_OK, report or handle if otherwise */
     printf(
         "Sample, TimeStamp(ms), Temperature(deg C), Pressure(Pa), Humidity(%%), Gas resistance(ohm), Status, Gas index, Meas index\n");
-    while (true)
-    {
-        /* Calculate delay period in microseconds */
-        del_period = bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, &bme) + (heatr_conf.shared_heatr_dur * 1000);
-        bme.delay_us(del_period, bme.intf_ptr);
-
-        float time_elapsed = time_us_64() / 1000000;
-
-        rslt = bme68x_get_data(BME68X_PARALLEL_MODE, data, &n_fields, &bme);
-        bme68x_check_rslt("bme68x_get_data", rslt);
 
-        /* Check if rslt == BME68X_OK, report or handle if otherwise */
-        for (uint8_t i = 0; i < n_fields; i++)
-        {
-            if (data[i].status == BME68X_VALID_DATA)
-            {
-#ifdef BME68X_USE_FPU
-                printf("Sample_count: %u, Time Elapsed: %.3f s, Temperature: %.2f C, Pressure: %.2f Pa, Humidity: %.2f %%, Gas_resistance: %.2f ohm, Status: 0x%x, Gas_index: %d, Meas_index %d\n",
-                       sample_count,
-                       time_elapsed,
-                       data[i].temperature,
-                       data[i].pressure,
-                       data[i].humidity,
-                       data[i].gas_resistance,
-                       data[i].status,
-                       data[i].gas_index,
-                       data[i].meas_index);
+#if EVENT_DRIVEN_ACQUISITION
+    run_event_loop();
 #else
-                printf("%u, %lu, %d, %lu, %lu, %lu, 0x%x, %d, %d\n",
-                       sample_count,
-                       (long unsigned int)time_ms,
-                       (data[i].temperature / 100),
-                       (long unsigned int)data[i].pressure,
-                       (long unsigned int)(data[i].humidity / 1000),
-                       (long unsigned int)data[i].gas_resistance,
-                       data[i].status,
-                       data[i].gas_index,
-                       data[i].meas_index);
+    run_delay_loop();
 #endif
-                sample_count++;
-            }
-        }
-    }
 
     bme68x_pico_deinit();
 
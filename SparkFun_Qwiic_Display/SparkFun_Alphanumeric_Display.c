@@ -1,4 +1,33 @@
 #include "SparkFun_Alphanumeric_Display.h"
+#include "hardware/sync.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+
+static void HT16K33_markDisconnected(HT16K33 *display, uint8_t displayNumber);
+static bool HT16K33_dirtyRange(HT16K33 *display, const uint8_t *ram, uint8_t displayNumber, uint8_t *first, uint8_t *last);
+static bool HT16K33_writeRAMAsync(HT16K33 *display, uint8_t displayNumber, uint8_t reg, uint8_t *buff, uint8_t buffSize);
+static bool HT16K33_queueRAM(HT16K33 *display, uint8_t displayNumber, uint8_t reg, uint8_t *buff, uint8_t buffSize);
+static bool HT16K33_writeBytes(HT16K33 *display, uint8_t displayNumber, uint8_t *data, uint8_t length);
+static bool HT16K33_queueBytes(HT16K33 *display, uint8_t displayNumber, uint8_t *data, uint8_t length);
+static bool HT16K33_pushRange(HT16K33 *display, uint8_t *ram, uint8_t displayNumber, uint8_t first, uint8_t last, bool fromTimer);
+static uint16_t HT16K33_charPosition(uint8_t displayChar);
+static void HT16K33_renderChar(uint8_t *ram, uint16_t segmentsToTurnOn, uint8_t digit);
+static bool HT16K33_refreshFrame(repeating_timer_t *rt);
+static bool HT16K33_writeCommand(HT16K33 *display, uint8_t command);
+static uint8_t HT16K33_blinkRateBits(float rate);
+static void HT16K33_renderScroll(HT16K33 *display);
+static bool HT16K33_scrollStep(repeating_timer_t *rt);
+static bool HT16K33_animationStep(repeating_timer_t *rt);
+static bool HT16K33_queueCommand(HT16K33 *display, uint8_t command);
+static void HT16K33_ditherDigits(HT16K33 *display, uint8_t *ram);
+static void HT16K33_keyIrq(void);
+static void HT16K33_keyReadDone(bool success, void *user_data);
+static bool HT16K33_readKeyRAM(HT16K33 *display);
+static void HT16K33_pushKeyEvent(HT16K33 *display, uint8_t displayNumber, uint8_t key, bool pressed);
+
+// Display serviced by the INT pin interrupt, only one display chain can use the keyscan
+static HT16K33 *keyscan_display;
+static void HT16K33_dmaDone(bool success, void *user_data);
 
 /*--------------------------- Character Map ----------------------------------*/
 #define SFE_ALPHANUM_UNKNOWN_CHAR 95
@@ -102,6 +131,22 @@ static const uint16_t alphanumeric_segs[96] = {
     0b11111111111111, // Unknown character (DEL or RUBOUT)
 };
 
+/*--------------------------- Segment Map ----------------------------------*/
+// RAM byte offset and bit of segment A to N for each digit of a display.
+// Segments A to G are on bits 0 to 3, H to N on bits 4 to 7, H and I swap their COM line.
+typedef struct
+{
+    uint8_t offset;
+    uint8_t mask;
+} HT16K33_segment_bit;
+
+static const HT16K33_segment_bit segment_map[4][14] = {
+    {{0, 0x01}, {2, 0x01}, {4, 0x01}, {6, 0x01}, {8, 0x01}, {10, 0x01}, {12, 0x01}, {2, 0x10}, {0, 0x10}, {4, 0x10}, {6, 0x10}, {8, 0x10}, {10, 0x10}, {12, 0x10}}, // digit 0
+    {{0, 0x02}, {2, 0x02}, {4, 0x02}, {6, 0x02}, {8, 0x02}, {10, 0x02}, {12, 0x02}, {2, 0x20}, {0, 0x20}, {4, 0x20}, {6, 0x20}, {8, 0x20}, {10, 0x20}, {12, 0x20}}, // digit 1
+    {{0, 0x04}, {2, 0x04}, {4, 0x04}, {6, 0x04}, {8, 0x04}, {10, 0x04}, {12, 0x04}, {2, 0x40}, {0, 0x40}, {4, 0x40}, {6, 0x40}, {8, 0x40}, {10, 0x40}, {12, 0x40}}, // digit 2
+    {{0, 0x08}, {2, 0x08}, {4, 0x08}, {6, 0x08}, {8, 0x08}, {10, 0x08}, {12, 0x08}, {2, 0x80}, {0, 0x80}, {4, 0x80}, {6, 0x80}, {8, 0x80}, {10, 0x80}, {12, 0x80}}, // digit 3
+};
+
 /*--------------------------- Device Status----------------------------------*/
 
 bool HT16K33_begin(HT16K33 *display, uint8_t addressDisplayOne, uint8_t addressDisplayTwo, uint8_t addressDisplayThree, uint8_t addressDisplayFour, i2c_inst_t *i2c_port)
@@ -121,6 +166,30 @@ bool HT16K33_begin(HT16K33 *display, uint8_t addressDisplayOne, uint8_t addressD
         display->number_of_displays = 1;
 
     display->i2c_port = i2c_port;
+    display->dma = NULL;
+    memset(display->char_overrides, 0, sizeof(display->char_overrides));
+
+    display->back_frame = 0;
+    display->frame_pending = false;
+    display->frame_sequence = 0;
+    display->frame_shown_sequence = 0;
+    display->frames_dropped = 0;
+    display->refresh_pool = NULL;
+    display->scrolling = false;
+    display->animating = false;
+    display->dithering = false;
+    display->dither_flush = false;
+    memset(display->digit_level, HT16K33_DIGIT_LEVELS, sizeof(display->digit_level));
+    display->keyscan_enabled = false;
+    critical_section_init(&display->frame_lock);
+
+    // Probe every display once, afterwards the link state is only updated by failed transfers
+    for (uint8_t i = 1; i <= 4; i++)
+    {
+        display->display_connected[i - 1] = false;
+        display->next_probe_time[i - 1] = get_absolute_time();
+        display->chip_ram_valid[i - 1] = false;
+    }
 
     for (uint8_t i = 1; i <= display->number_of_displays; i++)
     {
@@ -128,7 +197,7 @@ bool HT16K33_begin(HT16K33 *display, uint8_t addressDisplayOne, uint8_t addressD
         {
             return false;
         }
-        sleep_ms(100);
+        display->display_connected[i - 1] = true;
     }
 
     if (!HT16K33_initialize(display))
@@ -151,15 +220,20 @@ bool HT16K33_isConnected(HT16K33 *display, uint8_t displayNumber)
     uint8_t triesBeforeGiveup = 5;
     uint8_t address = HT16K33_lookUpDisplayAddress(display, displayNumber);
 
+    if (display->dma)
+        i2c_dma_wait_idle(display->dma);
+
+    // One ACK is enough, only a display that does not answer is retried
     for (uint8_t x = 0; x < triesBeforeGiveup; x++)
     {
-        if (i2c_write_blocking(display->i2c_port, address, NULL, 0, false) == PICO_ERROR_GENERIC)
+        display->bus_transactions++;
+        if (i2c_write_blocking(display->i2c_port, address, NULL, 0, false) != PICO_ERROR_GENERIC)
         {
-            return false;
+            return true;
         }
-        sleep_ms(100);
+        sleep_ms(10);
     }
-    return true;
+    return false;
 }
 
 bool HT16K33_initialize(HT16K33 *display)
@@ -203,26 +277,113 @@ uint8_t HT16K33_lookUpDisplayAddress(HT16K33 *display, uint8_t displayNumber)
     return 0;
 }
 
+uint8_t HT16K33_lookUpDisplayNumber(HT16K33 *display, uint8_t address)
+{
+    if (address == display->device_address_display_two)
+        return 2;
+    else if (address == display->device_address_display_three)
+        return 3;
+    else if (address == display->device_address_display_four)
+        return 4;
+    return 1;
+}
+
+// Check the cached link state of a display, a display marked as disconnected
+// is re-probed at most once every HT16K33_REPROBE_INTERVAL_MS
+bool HT16K33_checkLink(HT16K33 *display, uint8_t displayNumber)
+{
+    uint8_t index = displayNumber - 1;
+
+    if (display->display_connected[index])
+        return true;
+
+    if (!time_reached(display->next_probe_time[index]))
+        return false;
+
+    if (display->dma)
+        i2c_dma_wait_idle(display->dma);
+
+    display->bus_transactions++;
+    if (i2c_write_blocking(display->i2c_port, HT16K33_lookUpDisplayAddress(display, displayNumber), NULL, 0, false) == PICO_ERROR_GENERIC)
+    {
+        display->next_probe_time[index] = make_timeout_time_ms(HT16K33_REPROBE_INTERVAL_MS);
+        return false;
+    }
+
+    display->display_connected[index] = true;
+    return true;
+}
+
+static void HT16K33_markDisconnected(HT16K33 *display, uint8_t displayNumber)
+{
+    // The display may have lost its RAM, rewrite all of it once it is back
+    display->chip_ram_valid[displayNumber - 1] = false;
+    display->display_connected[displayNumber - 1] = false;
+    display->next_probe_time[displayNumber - 1] = make_timeout_time_ms(HT16K33_REPROBE_INTERVAL_MS);
+}
+
+// Push display RAM updates through a DMA driven bus, HT16K33_updateDisplay then returns as soon as the
+// transfers are queued. Configuration commands and reads stay blocking and wait for the queue to drain.
+void HT16K33_attachDMA(HT16K33 *display, i2c_dma_t *dma)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        display->dma_context[i].display = display;
+        display->dma_context[i].display_number = i + 1;
+    }
+    display->dma = dma;
+}
+
 /*-------------------------- Display configuration functions ---------------------------*/
 
 bool HT16K33_clear(HT16K33 *display)
 {
-    memset(display->display_ram, 0, 16 * display->number_of_displays);
+    memset(display->display_ram, 0, HT16K33_RAM_BLOCK * display->number_of_displays);
     display->digit_position = 0;
     return HT16K33_updateDisplay(display);
 }
 
-bool HT16K33_setBrightness(HT16K33 *display, uint8_t duty)
+// Send the same command to every display. With DMA attached all commands are queued back to back
+// and the bus is only waited for once. A controller restart is needed to change the target address,
+// so the commands can't share one transfer.
+static bool HT16K33_writeCommand(HT16K33 *display, uint8_t command)
 {
     bool status = true;
+
     for (uint8_t i = 1; i <= display->number_of_displays; i++)
     {
-        if (!HT16K33_setBrightnessSingle(display, i, duty))
+        if (display->dma)
+        {
+            if (!HT16K33_writeRAMAsync(display, i, command, NULL, 0))
+                status = false;
+        }
+        else if (!HT16K33_writeRAM_single(display, HT16K33_lookUpDisplayAddress(display, i), command))
+        {
             status = false;
+        }
+    }
+
+    if (display->dma)
+    {
+        // Failed transfers mark their display as disconnected
+        i2c_dma_wait_idle(display->dma);
+        for (uint8_t i = 1; i <= display->number_of_displays; i++)
+        {
+            if (!display->display_connected[i - 1])
+                status = false;
+        }
     }
     return status;
 }
 
+bool HT16K33_setBrightness(HT16K33 *display, uint8_t duty)
+{
+    if (duty > 15)
+        duty = 15;
+
+    return HT16K33_writeCommand(display, ALPHA_CMD_DIMMING_SETUP | duty);
+}
+
 bool HT16K33_setBrightnessSingle(HT16K33 *display, uint8_t displayNumber, uint8_t duty)
 {
     if (duty > 15)
@@ -232,27 +393,25 @@ bool HT16K33_setBrightnessSingle(HT16K33 *display, uint8_t displayNumber, uint8_
     return HT16K33_writeRAM_single(display, HT16K33_lookUpDisplayAddress(display, displayNumber), dataToWrite);
 }
 
+static uint8_t HT16K33_blinkRateBits(float rate)
+{
+    if (rate == 2.0)
+        return ALPHA_BLINK_RATE_2HZ;
+    else if (rate == 1.0)
+        return ALPHA_BLINK_RATE_1HZ;
+    else if (rate == 0.5)
+        return ALPHA_BLINK_RATE_0_5HZ;
+    return ALPHA_BLINK_RATE_NOBLINK;
+}
+
 bool HT16K33_setBlinkRate(HT16K33 *display, float rate)
 {
-    bool status = true;
-    for (uint8_t i = 1; i <= display->number_of_displays; i++)
-    {
-        if (!HT16K33_setBlinkRateSingle(display, i, rate))
-            status = false;
-    }
-    return status;
+    return HT16K33_writeCommand(display, ALPHA_CMD_DISPLAY_SETUP | (HT16K33_blinkRateBits(rate) << 1) | display->display_on_off);
 }
 
 bool HT16K33_setBlinkRateSingle(HT16K33 *display, uint8_t displayNumber, float rate)
 {
-    uint8_t blinkRate = ALPHA_BLINK_RATE_NOBLINK;
-
-    if (rate == 2.0)
-        blinkRate = ALPHA_BLINK_RATE_2HZ;
-    else if (rate == 1.0)
-        blinkRate = ALPHA_BLINK_RATE_1HZ;
-    else if (rate == 0.5)
-        blinkRate = ALPHA_BLINK_RATE_0_5HZ;
+    uint8_t blinkRate = HT16K33_blinkRateBits(rate);
 
     uint8_t dataToWrite = ALPHA_CMD_DISPLAY_SETUP | (blinkRate << 1) | display->display_on_off;
     return HT16K33_writeRAM_single(display, HT16K33_lookUpDisplayAddress(display, displayNumber), dataToWrite);
@@ -260,28 +419,14 @@ bool HT16K33_setBlinkRateSingle(HT16K33 *display, uint8_t displayNumber, float r
 
 bool HT16K33_displayOn(HT16K33 *display)
 {
-    bool status = true;
     display->display_on_off = ALPHA_DISPLAY_ON;
-
-    for (uint8_t i = 1; i <= display->number_of_displays; i++)
-    {
-        if (!HT16K33_displayOnSingle(display, i))
-            status = false;
-    }
-    return status;
+    return HT16K33_writeCommand(display, ALPHA_CMD_DISPLAY_SETUP | (display->blink_rate << 1) | display->display_on_off);
 }
 
 bool HT16K33_displayOff(HT16K33 *display)
 {
-    bool status = true;
     display->display_on_off = ALPHA_DISPLAY_OFF;
-
-    for (uint8_t i = 1; i <= display->number_of_displays; i++)
-    {
-        if (!HT16K33_displayOffSingle(display, i))
-            status = false;
-    }
-    return status;
+    return HT16K33_writeCommand(display, ALPHA_CMD_DISPLAY_SETUP | (display->blink_rate << 1) | display->display_on_off);
 }
 
 bool HT16K33_displayOnSingle(HT16K33 *display, uint8_t displayNumber)
@@ -303,24 +448,14 @@ bool HT16K33_setDisplayOnOff(HT16K33 *display, uint8_t displayNumber, bool turnO
 
 bool HT16K33_enableSystemClock(HT16K33 *display)
 {
-    bool status = true;
-    for (uint8_t i = 1; i <= display->number_of_displays; i++)
-    {
-        if (!HT16K33_enableSystemClockSingle(display, i))
-            status = false;
-    }
+    bool status = HT16K33_writeCommand(display, ALPHA_CMD_SYSTEM_SETUP | 1); // Enable system clock
+    sleep_ms(1);
     return status;
 }
 
 bool HT16K33_disableSystemClock(HT16K33 *display)
 {
-    bool status = true;
-    for (uint8_t i = 1; i <= display->number_of_displays; i++)
-    {
-        if (!HT16K33_disableSystemClockSingle(display, i))
-            status = false;
-    }
-    return status;
+    return HT16K33_writeCommand(display, ALPHA_CMD_SYSTEM_SETUP | 0); // Standby mode
 }
 
 bool HT16K33_enableSystemClockSingle(HT16K33 *display, uint8_t displayNumber)
@@ -341,101 +476,153 @@ bool HT16K33_disableSystemClockSingle(HT16K33 *display, uint8_t displayNumber)
 
 void HT16K33_illuminateSegment(HT16K33 *display, uint8_t segment, uint8_t digit)
 {
-    uint8_t com = segment - 'A';
-
-    if (com > 6)
-        com -= 7;
-    if (segment == 'I')
-        com = 0;
-    if (segment == 'H')
-        com = 1;
-
-    uint8_t row = digit % 4;
-    if (segment > 'G')
-        row += 4;
-
-    uint8_t offset = digit / 4 * 16;
-    uint8_t adr = com * 2 + offset;
-
-    if (row > 7)
-        adr++;
+    if (segment < 'A' || segment > 'N')
+        return;
 
-    if (row > 7)
-        row -= 8;
-    uint8_t dat = 1 << row;
-
-    display->display_ram[adr] |= dat;
+    const HT16K33_segment_bit *bit = &segment_map[digit % 4][segment - 'A'];
+    HT16K33_RAM(display->display_ram, digit / 4)[bit->offset] |= bit->mask;
 }
 
 void HT16K33_illuminateChar(HT16K33 *display, uint16_t segmentsToTurnOn, uint8_t digit)
 {
-    for (uint8_t i = 0; i < 14; i++)
-    {
-        if ((segmentsToTurnOn >> i) & 0b1)
-            HT16K33_illuminateSegment(display, 'A' + i, digit);
-    }
+    HT16K33_renderChar(display->display_ram, segmentsToTurnOn, digit);
 }
 
-void HT16K33_printChar(HT16K33 *display, uint8_t displayChar, uint8_t digit)
+static void HT16K33_renderChar(uint8_t *ram, uint16_t segmentsToTurnOn, uint8_t digit)
 {
-    uint16_t characterPosition = 65532;
+    const HT16K33_segment_bit *map = segment_map[digit % 4];
+    uint16_t segments = segmentsToTurnOn & 0x3FFF;
 
-    if (displayChar == ' ')
-        characterPosition = 0;
-    else if (displayChar >= '!' && displayChar <= '~')
+    ram = HT16K33_RAM(ram, digit / 4);
+
+    // Visit only the lit segments
+    while (segments)
     {
-        characterPosition = displayChar - '!' + 1;
+        const HT16K33_segment_bit *bit = &map[__builtin_ctz(segments)];
+        ram[bit->offset] |= bit->mask;
+        segments &= segments - 1;
     }
+}
 
+// Position of a character in alphanumeric_segs and char_overrides
+static uint16_t HT16K33_charPosition(uint8_t displayChar)
+{
+    if (displayChar == ' ')
+        return 0;
+    if (displayChar >= '!' && displayChar <= '~')
+        return displayChar - '!' + 1;
+    return SFE_ALPHANUM_UNKNOWN_CHAR;
+}
+
+void HT16K33_printChar(HT16K33 *display, uint8_t displayChar, uint8_t digit)
+{
+    uint16_t characterPosition = HT16K33_charPosition(displayChar);
     uint8_t dispNum = display->digit_position / 4;
 
     if (characterPosition == 14)
         HT16K33_decimalOnSingle(display, dispNum + 1, false);
     if (characterPosition == 26)
         HT16K33_colonOnSingle(display, dispNum + 1, false);
-    if (characterPosition == 65532)
-        characterPosition = SFE_ALPHANUM_UNKNOWN_CHAR;
 
     uint16_t segmentsToTurnOn = HT16K33_getSegmentsToTurnOn(display, characterPosition);
     HT16K33_illuminateChar(display, segmentsToTurnOn, digit);
 }
 
+// Find the bytes of the 16 byte display RAM image that differ from what the display holds.
+// Returns false if the display is up to date.
+static bool HT16K33_dirtyRange(HT16K33 *display, const uint8_t *ram, uint8_t displayNumber, uint8_t *first, uint8_t *last)
+{
+    uint8_t *chip = display->chip_ram + (displayNumber - 1) * 16;
+
+    if (!display->chip_ram_valid[displayNumber - 1])
+    {
+        *first = 0;
+        *last = 15;
+        return true;
+    }
+
+    uint8_t start = 0;
+    while (start < 16 && ram[start] == chip[start])
+        start++;
+    if (start == 16)
+        return false;
+
+    uint8_t end = 15;
+    while (ram[end] == chip[end])
+        end--;
+
+    *first = start;
+    *last = end;
+    return true;
+}
+
+// Only the changed byte range of each display is written, the HT16K33 auto-increments the RAM address
 bool HT16K33_updateDisplay(HT16K33 *display)
 {
     bool status = true;
+    uint8_t first, last;
+
     for (uint8_t i = 1; i <= display->number_of_displays; i++)
     {
-        if (!HT16K33_writeRAM(display, HT16K33_lookUpDisplayAddress(display, i), 0, display->display_ram + ((i - 1) * 16), 16))
-        {
+        if (!HT16K33_dirtyRange(display, HT16K33_RAM(display->display_ram, i - 1), i, &first, &last))
+            continue;
+
+        if (!HT16K33_pushRange(display, display->display_ram, i, first, last, false))
             status = false;
-        }
     }
     return status;
 }
 
+// Send RAM bytes first to last of a display from a frame laid out in HT16K33_RAM_BLOCKs. The byte in
+// front of the range holds the register address. On the DMA path it is borrowed only until
+// i2c_dma_write has copied the transfer into its queue. A blocking write reads the frame for the
+// whole transfer, so it starts at 0 from the spare byte of the block instead, at the cost of up to
+// 15 unchanged bytes. The shadow copy is updated and marked valid before the transfer is queued,
+// so a failure that HT16K33_dmaDone reports for this transfer is never overwritten.
+static bool HT16K33_pushRange(HT16K33 *display, uint8_t *ram, uint8_t displayNumber, uint8_t first, uint8_t last, bool fromTimer)
+{
+    if (display->dma == NULL)
+        first = 0;
+
+    uint8_t *data = HT16K33_RAM(ram, displayNumber - 1) + first - 1;
+    uint8_t length = last - first + 2;
+    uint8_t saved = *data;
+    bool status;
+
+    memcpy(display->chip_ram + (displayNumber - 1) * 16 + first, data + 1, length - 1);
+    display->chip_ram_valid[displayNumber - 1] = true;
+
+    *data = first;
+    if (display->dma == NULL)
+        status = HT16K33_writeBytes(display, displayNumber, data, length);
+    else if (fromTimer)
+        status = HT16K33_queueBytes(display, displayNumber, data, length);
+    else if (!HT16K33_checkLink(display, displayNumber))
+        status = false;
+    else if (HT16K33_queueBytes(display, displayNumber, data, length))
+        status = true;
+    else
+    {
+        // Queue full, let it drain and try once more. The borrowed byte is put back while waiting.
+        *data = saved;
+        i2c_dma_wait_idle(display->dma);
+        *data = first;
+        status = HT16K33_queueBytes(display, displayNumber, data, length);
+    }
+    *data = saved;
+
+    if (!status)
+        display->chip_ram_valid[displayNumber - 1] = false;
+    return status;
+}
+
+// Redefining a character replaces the earlier definition
 bool HT16K33_defineChar(HT16K33 *display, uint8_t displayChar, uint16_t segmentsToTurnOn)
 {
     if (displayChar >= '!' && displayChar <= '~')
     {
         uint16_t characterPosition = displayChar - '!' + 1;
-        struct CharDef *pNewCharDef = (struct CharDef *)calloc(1, sizeof(struct CharDef));
-        pNewCharDef->position = characterPosition;
-        pNewCharDef->segments = segmentsToTurnOn & 0x3FFF;
-        pNewCharDef->next = NULL;
-
-        if (display->char_def_list == NULL)
-        {
-            display->char_def_list = pNewCharDef;
-        }
-        else
-        {
-            struct CharDef *pTail = display->char_def_list;
-            while (pTail->next != NULL)
-            {
-                pTail = pTail->next;
-            }
-            pTail->next = pNewCharDef;
-        }
+        display->char_overrides[characterPosition] = HT16K33_GLYPH_DEFINED | (segmentsToTurnOn & 0x3FFF);
         return true;
     }
     return false;
@@ -443,67 +630,80 @@ bool HT16K33_defineChar(HT16K33 *display, uint8_t displayChar, uint16_t segments
 
 uint16_t HT16K33_getSegmentsToTurnOn(HT16K33 *display, uint8_t charPos)
 {
-    struct CharDef *pDefChar = display->char_def_list;
+    uint16_t segments = display->char_overrides[charPos];
 
-    while (pDefChar && (pDefChar->position != charPos))
-    {
-        pDefChar = pDefChar->next;
-    }
+    if (segments & HT16K33_GLYPH_DEFINED)
+        return segments & 0x3FFF;
 
-    if (pDefChar != NULL)
-    {
-        return pDefChar->segments;
-    }
-    else
-    {
-        return alphanumeric_segs[charPos];
-    }
+    return alphanumeric_segs[charPos];
 }
 
 bool HT16K33_readRAM(HT16K33 *display, uint8_t address, uint8_t reg, uint8_t *buff, uint8_t buffSize)
 {
-    uint8_t displayNum = 1;
-    if (address == display->device_address_display_two)
-        displayNum = 2;
-    else if (address == display->device_address_display_three)
-        displayNum = 3;
-    else if (address == display->device_address_display_four)
-        displayNum = 4;
-    HT16K33_isConnected(display, displayNum);
+    uint8_t displayNum = HT16K33_lookUpDisplayNumber(display, address);
+    if (!HT16K33_checkLink(display, displayNum))
+        return false;
+
+    if (display->dma)
+        i2c_dma_wait_idle(display->dma);
 
+    display->bus_transactions++;
+    display->bus_bytes++;
     if (i2c_write_blocking(display->i2c_port, address, &reg, 1, true) == PICO_ERROR_GENERIC)
     {
+        HT16K33_markDisconnected(display, displayNum);
         return false;
     }
 
+    display->bus_transactions++;
+    display->bus_bytes += buffSize;
     if (i2c_read_blocking(display->i2c_port, address, buff, buffSize, false) > 0)
     {
         return true;
     }
 
+    HT16K33_markDisconnected(display, displayNum);
     return false;
 }
 
 bool HT16K33_writeRAM(HT16K33 *display, uint8_t address, uint8_t reg, uint8_t *buff, uint8_t buffSize)
 {
-    uint8_t displayNum = 1;
-    if (address == display->device_address_display_two)
-        displayNum = 2;
-    else if (address == display->device_address_display_three)
-        displayNum = 3;
-    else if (address == display->device_address_display_four)
-        displayNum = 4;
-    HT16K33_isConnected(display, displayNum);
+    uint8_t displayNum = HT16K33_lookUpDisplayNumber(display, address);
+    uint8_t data[16 + 1];
+
+    // The display RAM is 16 bytes, display updates don't come through here
+    if (buffSize > 16)
+        return false;
 
-    uint8_t data[buffSize + 1];
     data[0] = reg;
     memcpy(&data[1], buff, buffSize);
 
-    if (i2c_write_blocking(display->i2c_port, address, data, buffSize + 1, false) == PICO_ERROR_GENERIC)
+    if (!HT16K33_writeBytes(display, displayNum, data, buffSize + 1))
+        return false;
+
+    // Keep the copy of the display RAM in step with writes to RAM addresses
+    if (buffSize > 0 && reg + buffSize <= 16)
+        memcpy(display->chip_ram + (displayNum - 1) * 16 + reg, buff, buffSize);
+
+    return true;
+}
+
+// Blocking write of a register address followed by its data
+static bool HT16K33_writeBytes(HT16K33 *display, uint8_t displayNumber, uint8_t *data, uint8_t length)
+{
+    if (!HT16K33_checkLink(display, displayNumber))
+        return false;
+
+    if (display->dma)
+        i2c_dma_wait_idle(display->dma);
+
+    display->bus_transactions++;
+    display->bus_bytes += length;
+    if (i2c_write_blocking(display->i2c_port, HT16K33_lookUpDisplayAddress(display, displayNumber), data, length, false) == PICO_ERROR_GENERIC)
     {
+        HT16K33_markDisconnected(display, displayNumber);
         return false;
     }
-
     return true;
 }
 
@@ -512,6 +712,61 @@ bool HT16K33_writeRAM_single(HT16K33 *display, uint8_t address, uint8_t dataToWr
     return HT16K33_writeRAM(display, address, dataToWrite, NULL, 0);
 }
 
+static bool HT16K33_writeRAMAsync(HT16K33 *display, uint8_t displayNumber, uint8_t reg, uint8_t *buff, uint8_t buffSize)
+{
+    if (!HT16K33_checkLink(display, displayNumber))
+        return false;
+
+    if (HT16K33_queueRAM(display, displayNumber, reg, buff, buffSize))
+        return true;
+
+    // Queue full, let it drain and try once more
+    i2c_dma_wait_idle(display->dma);
+    return HT16K33_queueRAM(display, displayNumber, reg, buff, buffSize);
+}
+
+// Never blocks, safe to call from the refresh timer
+static bool HT16K33_queueRAM(HT16K33 *display, uint8_t displayNumber, uint8_t reg, uint8_t *buff, uint8_t buffSize)
+{
+    uint8_t data[16 + 1];
+
+    if (buffSize > 16)
+        return false;
+
+    data[0] = reg;
+    memcpy(&data[1], buff, buffSize);
+
+    if (!HT16K33_queueBytes(display, displayNumber, data, buffSize + 1))
+        return false;
+
+    // A failed transfer invalidates the copy again in HT16K33_dmaDone
+    if (reg + buffSize <= 16)
+        memcpy(display->chip_ram + (displayNumber - 1) * 16 + reg, buff, buffSize);
+    return true;
+}
+
+static void HT16K33_dmaDone(bool success, void *user_data)
+{
+    HT16K33_dma_context *context = (HT16K33_dma_context *)user_data;
+
+    if (!success)
+        HT16K33_markDisconnected((HT16K33 *)context->display, context->display_number);
+}
+
+// The DMA bus copies the data while queueing, it can be reused as soon as this returns
+static bool HT16K33_queueBytes(HT16K33 *display, uint8_t displayNumber, uint8_t *data, uint8_t length)
+{
+    uint8_t address = HT16K33_lookUpDisplayAddress(display, displayNumber);
+    void *context = &display->dma_context[displayNumber - 1];
+
+    if (!i2c_dma_write(display->dma, address, data, length, HT16K33_dmaDone, context))
+        return false;
+
+    display->bus_transactions++;
+    display->bus_bytes += length;
+    return true;
+}
+
 /*---------------------------- Decimal functions ---------------------------------*/
 
 bool HT16K33_decimalOn(HT16K33 *display)
@@ -556,8 +811,8 @@ bool HT16K33_setDecimalOnOff(HT16K33 *display, uint8_t displayNumber, bool turnO
     uint8_t adr = 0x03;
     uint8_t dat = turnOnDecimal ? 0x01 : 0x00;
 
-    display->display_ram[adr + (displayNumber - 1) * 16] &= 0xFE;
-    display->display_ram[adr + (displayNumber - 1) * 16] |= dat;
+    HT16K33_RAM(display->display_ram, displayNumber - 1)[adr] &= 0xFE;
+    HT16K33_RAM(display->display_ram, displayNumber - 1)[adr] |= dat;
 
     if (updateNow)
     {
@@ -612,8 +867,8 @@ bool HT16K33_setColonOnOff(HT16K33 *display, uint8_t displayNumber, bool turnOnC
     uint8_t adr = 0x01;
     uint8_t dat = turnOnColon ? 0x01 : 0x00;
 
-    display->display_ram[adr + (displayNumber - 1) * 16] &= 0xFE;
-    display->display_ram[adr + (displayNumber - 1) * 16] |= dat;
+    HT16K33_RAM(display->display_ram, displayNumber - 1)[adr] &= 0xFE;
+    HT16K33_RAM(display->display_ram, displayNumber - 1)[adr] |= dat;
 
     if (updateNow)
     {
@@ -664,14 +919,20 @@ bool HT16K33_shiftLeft(HT16K33 *display, uint8_t shiftAmt)
 }
 
 bool HT16K33_print(HT16K33 *display, const char *str)
+{
+    return HT16K33_printN(display, str, SIZE_MAX);
+}
+
+// Print at most length characters of str, stops early at a terminating zero
+bool HT16K33_printN(HT16K33 *display, const char *str, size_t length)
 {
     if (str == NULL)
         return false;
 
-    memset(display->display_ram, 0, 16 * display->number_of_displays);
+    memset(display->display_ram, 0, HT16K33_RAM_BLOCK * display->number_of_displays);
     display->digit_position = 0;
 
-    for (size_t i = 0; i < strlen(str) && display->digit_position < (4 * display->number_of_displays); i++)
+    for (size_t i = 0; i < length && str[i] != '\0' && display->digit_position < (4 * display->number_of_displays); i++)
     {
         char c = str[i];
         if (c == '.')
@@ -687,4 +948,665 @@ bool HT16K33_print(HT16K33 *display, const char *str)
     }
 
     return HT16K33_updateDisplay(display);
-}
\ No newline at end of file
+}
+
+// Print value / 10^decimals right aligned over all digits, without going through printf. The digits
+// are formatted into a small char buffer by HT16K33_formatFixed and then drawn by HT16K33_printN.
+bool HT16K33_printFixed(HT16K33 *display, int32_t value, uint8_t decimals)
+{
+    char buffer[4 * 4 + 2];
+    uint8_t length = HT16K33_formatFixed(buffer, 4 * display->number_of_displays, value, decimals);
+
+    if (length == 0)
+        return false;
+
+    return HT16K33_printN(display, buffer, length);
+}
+
+// Format value / 10^decimals right aligned in width digits. The decimal point does not take a digit,
+// buffer must hold width + 2 characters. Returns the string length or 0 if the value does not fit.
+uint8_t HT16K33_formatFixed(char *buffer, uint8_t width, int32_t value, uint8_t decimals)
+{
+    char digits[10];
+    uint8_t count = 0;
+    uint8_t length = 0;
+    bool negative = value < 0;
+    uint32_t magnitude = negative ? -(uint32_t)value : (uint32_t)value;
+
+    if (decimals >= sizeof(digits))
+        return 0;
+
+    // At least one digit in front of the decimal point
+    do
+    {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while ((magnitude || count <= decimals) && count < sizeof(digits));
+
+    if (magnitude || count + negative > width)
+        return 0;
+
+    for (uint8_t i = count + negative; i < width; i++)
+        buffer[length++] = ' ';
+    if (negative)
+        buffer[length++] = '-';
+
+    while (count--)
+    {
+        buffer[length++] = digits[count];
+        if (count == decimals && decimals > 0)
+            buffer[length++] = '.';
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+/*---------------------------- Frame functions ---------------------------------*/
+
+// Push submitted frames from a repeating timer on the calling core, which must be the core that
+// initialized the attached DMA bus. While the refresh runs only the frame functions may be used.
+bool HT16K33_startRefresh(HT16K33 *display, uint32_t refreshHz)
+{
+    if (display->dma == NULL || display->refresh_pool != NULL || refreshHz == 0)
+        return false;
+
+    // Timers for the refresh, the scroll engine and the animation engine
+    display->refresh_pool = alarm_pool_create_with_unused_hardware_alarm(3);
+    if (display->refresh_pool == NULL)
+        return false;
+
+    // A negative delay keeps the period fixed regardless of the callback run time
+    if (!alarm_pool_add_repeating_timer_us(display->refresh_pool, -(int64_t)(1000000 / refreshHz), HT16K33_refreshFrame, display, &display->refresh_timer))
+    {
+        alarm_pool_destroy(display->refresh_pool);
+        display->refresh_pool = NULL;
+        return false;
+    }
+    return true;
+}
+
+void HT16K33_stopRefresh(HT16K33 *display)
+{
+    if (display->refresh_pool == NULL)
+        return;
+
+    HT16K33_stopScroll(display);
+    HT16K33_stopAnimation(display);
+    cancel_repeating_timer(&display->refresh_timer);
+    alarm_pool_destroy(display->refresh_pool);
+    display->refresh_pool = NULL;
+    __sev();
+    i2c_dma_wait_idle(display->dma);
+}
+
+// The back buffer, one HT16K33_RAM_BLOCK per display, use HT16K33_RAM to reach the display RAM.
+// Its content is undefined after HT16K33_submitFrame.
+uint8_t *HT16K33_frameBuffer(HT16K33 *display)
+{
+    return display->frame_buffers[display->back_frame];
+}
+
+// Render a string into the back buffer, same rules as HT16K33_print
+bool HT16K33_framePrint(HT16K33 *display, const char *str)
+{
+    if (str == NULL)
+        return false;
+
+    uint8_t *ram = HT16K33_frameBuffer(display);
+    uint8_t digits = 4 * display->number_of_displays;
+    uint8_t digit = 0;
+
+    memset(ram, 0, HT16K33_RAM_BLOCK * display->number_of_displays);
+
+    for (; *str != '\0' && digit < digits; str++)
+    {
+        if (*str == '.')
+            HT16K33_RAM(ram, digit / 4)[3] |= 0x01;
+        else if (*str == ':')
+            HT16K33_RAM(ram, digit / 4)[1] |= 0x01;
+        else
+        {
+            HT16K33_renderChar(ram, HT16K33_getSegmentsToTurnOn(display, HT16K33_charPosition(*str)), digit);
+            digit++;
+        }
+    }
+    return true;
+}
+
+// Swap the back buffer to the front, returns the frame sequence number.
+// A frame that was not shown yet is replaced and counted in frames_dropped.
+uint32_t HT16K33_submitFrame(HT16K33 *display)
+{
+    critical_section_enter_blocking(&display->frame_lock);
+    if (display->frame_pending)
+        display->frames_dropped++;
+    display->back_frame ^= 1;
+    display->frame_pending = true;
+    uint32_t sequence = ++display->frame_sequence;
+    critical_section_exit(&display->frame_lock);
+    return sequence;
+}
+
+// Wait until the last submitted frame has been queued to the displays
+void HT16K33_waitFrame(HT16K33 *display)
+{
+    while (display->frame_pending && display->refresh_pool != NULL)
+        __wfe();
+}
+
+static bool HT16K33_refreshFrame(repeating_timer_t *rt)
+{
+    HT16K33 *display = (HT16K33 *)rt->user_data;
+    uint8_t first, last;
+    uint8_t dithered[HT16K33_RAM_BLOCK * 4];
+    uint8_t *ram = display->display_ram;
+    bool new_frame = display->frame_pending;
+
+    // Leave the frame pending if the previous one is still on the bus. Dithered digits are
+    // rendered on every refresh even without a new frame, and once more after dithering ends so
+    // the last dithered pattern doesn't stay on the chip.
+    if ((!new_frame && !display->dithering && !display->dither_flush) || i2c_dma_busy(display->dma))
+        return true;
+    display->dither_flush = false;
+
+    uint32_t sequence = 0;
+    if (new_frame)
+    {
+        critical_section_enter_blocking(&display->frame_lock);
+        memcpy(display->display_ram, display->frame_buffers[display->back_frame ^ 1], HT16K33_RAM_BLOCK * display->number_of_displays);
+        sequence = display->frame_sequence;
+        display->frame_pending = false;
+        critical_section_exit(&display->frame_lock);
+    }
+
+    if (display->dithering)
+    {
+        memcpy(dithered, display->display_ram, HT16K33_RAM_BLOCK * display->number_of_displays);
+        HT16K33_ditherDigits(display, dithered);
+        ram = dithered;
+    }
+
+    for (uint8_t i = 1; i <= display->number_of_displays; i++)
+    {
+        // No blocking probe here, the write itself tells if a disconnected display is back
+        if (!display->display_connected[i - 1])
+        {
+            if (!time_reached(display->next_probe_time[i - 1]))
+                continue;
+            display->display_connected[i - 1] = true;
+        }
+
+        if (!HT16K33_dirtyRange(display, HT16K33_RAM(ram, i - 1), i, &first, &last))
+            continue;
+
+        HT16K33_pushRange(display, ram, i, first, last, true);
+    }
+
+    if (new_frame)
+        display->frame_shown_sequence = sequence;
+
+    // Wake HT16K33_waitFrame on either core
+    __sev();
+    return true;
+}
+
+/*---------------------------- Scroll functions ---------------------------------*/
+
+// Scroll text of any length through the displays as a marquee, one digit every stepMs. The glyphs are
+// looked up once here, the scroll timer only renders the window and submits it as a frame, so the
+// refresh writes just the bytes that changed. Needs HT16K33_startRefresh and the same core.
+// '.' and ':' are shown as their glyphs, the display wide decimal and colon are not used.
+bool HT16K33_startScroll(HT16K33 *display, const char *text, uint32_t stepMs)
+{
+    if (text == NULL || display->refresh_pool == NULL || stepMs == 0)
+        return false;
+
+    HT16K33_stopScroll(display);
+
+    uint16_t length = 0;
+    for (; text[length] != '\0' && length < HT16K33_SCROLL_MAX_LENGTH; length++)
+    {
+        display->scroll_glyphs[length] = HT16K33_getSegmentsToTurnOn(display, HT16K33_charPosition(text[length]));
+    }
+    display->scroll_length = length;
+    display->scroll_position = 0;
+
+    HT16K33_renderScroll(display);
+
+    if (!alarm_pool_add_repeating_timer_us(display->refresh_pool, -(int64_t)stepMs * 1000, HT16K33_scrollStep, display, &display->scroll_timer))
+        return false;
+
+    display->scrolling = true;
+    return true;
+}
+
+void HT16K33_stopScroll(HT16K33 *display)
+{
+    if (!display->scrolling)
+        return;
+
+    cancel_repeating_timer(&display->scroll_timer);
+    display->scrolling = false;
+}
+
+// The text is followed by one blank window before it starts over
+static void HT16K33_renderScroll(HT16K33 *display)
+{
+    uint8_t *ram = HT16K33_frameBuffer(display);
+    uint8_t digits = 4 * display->number_of_displays;
+    uint16_t total = display->scroll_length + digits;
+
+    memset(ram, 0, HT16K33_RAM_BLOCK * display->number_of_displays);
+
+    for (uint8_t digit = 0; digit < digits; digit++)
+    {
+        uint16_t index = (display->scroll_position + digit) % total;
+        if (index < display->scroll_length)
+            HT16K33_renderChar(ram, display->scroll_glyphs[index], digit);
+    }
+
+    HT16K33_submitFrame(display);
+}
+
+static bool HT16K33_scrollStep(repeating_timer_t *rt)
+{
+    HT16K33 *display = (HT16K33 *)rt->user_data;
+
+    display->scroll_position = (display->scroll_position + 1) % (display->scroll_length + 4 * display->number_of_displays);
+    HT16K33_renderScroll(display);
+    return true;
+}
+
+/*---------------------------- Animation functions ---------------------------------*/
+
+// Run the keyframes one after another from a timer in the refresh alarm pool, every
+// HT16K33_ANIMATION_TICK_MS. Brightness and blink are queued as commands without blocking, digit
+// levels are dithered by the refresh, which should then run at 100 Hz or more to avoid flicker.
+// Needs HT16K33_startRefresh and the same core.
+bool HT16K33_startAnimation(HT16K33 *display, const HT16K33_keyframe *keyframes, uint8_t count, bool loop)
+{
+    if (display->refresh_pool == NULL || keyframes == NULL || count == 0 || count > HT16K33_MAX_KEYFRAMES)
+        return false;
+
+    HT16K33_stopAnimation(display);
+
+    memcpy(display->animation, keyframes, count * sizeof(HT16K33_keyframe));
+    display->animation_length = count;
+    display->animation_index = 0;
+    display->animation_loop = loop;
+    display->animation_duty = 0xFF; // Unknown, the first brightness keyframe always sends
+    display->animation_on = display->display_on_off;
+    display->keyframe_start = get_absolute_time();
+
+    if (!alarm_pool_add_repeating_timer_ms(display->refresh_pool, -HT16K33_ANIMATION_TICK_MS, HT16K33_animationStep, display, &display->animation_timer))
+        return false;
+
+    display->animating = true;
+    return true;
+}
+
+void HT16K33_stopAnimation(HT16K33 *display)
+{
+    if (!display->animating)
+        return;
+
+    cancel_repeating_timer(&display->animation_timer);
+    display->animating = false;
+    __sev();
+}
+
+bool HT16K33_animationRunning(HT16K33 *display)
+{
+    return display->animating;
+}
+
+// Wait until a non-looping animation has ended or was stopped
+void HT16K33_waitAnimation(HT16K33 *display)
+{
+    while (display->animating)
+        __wfe();
+}
+
+// Show a digit at level / HT16K33_DIGIT_LEVELS of its brightness, HT16K33_ALL_DIGITS for every digit.
+// Only has an effect while the refresh is running.
+void HT16K33_setDigitLevel(HT16K33 *display, uint8_t digit, uint8_t level)
+{
+    if (level > HT16K33_DIGIT_LEVELS)
+        level = HT16K33_DIGIT_LEVELS;
+
+    if (digit == HT16K33_ALL_DIGITS)
+        memset(display->digit_level, level, sizeof(display->digit_level));
+    else if (digit < 16)
+        display->digit_level[digit] = level;
+
+    bool dithering = false;
+    for (uint8_t i = 0; i < 4 * display->number_of_displays; i++)
+    {
+        if (display->digit_level[i] < HT16K33_DIGIT_LEVELS)
+            dithering = true;
+    }
+    if (display->dithering && !dithering)
+        display->dither_flush = true;
+    display->dithering = dithering;
+}
+
+static bool HT16K33_animationStep(repeating_timer_t *rt)
+{
+    HT16K33 *display = (HT16K33 *)rt->user_data;
+    const HT16K33_keyframe *keyframe = &display->animation[display->animation_index];
+    uint32_t elapsed_ms = absolute_time_diff_us(display->keyframe_start, get_absolute_time()) / 1000;
+    bool done = elapsed_ms >= keyframe->duration_ms;
+    bool applied = true;
+
+    if (done)
+        elapsed_ms = keyframe->duration_ms;
+
+    int32_t value = keyframe->end;
+    if (keyframe->duration_ms)
+        value = keyframe->start + ((int32_t)keyframe->end - keyframe->start) * (int32_t)elapsed_ms / (int32_t)keyframe->duration_ms;
+
+    switch (keyframe->type)
+    {
+    case HT16K33_ANIM_BRIGHTNESS:
+        if (value > 15)
+            value = 15;
+        if (value != display->animation_duty)
+        {
+            // Retried on the next tick if the bus queue is full
+            applied = HT16K33_queueCommand(display, ALPHA_CMD_DIMMING_SETUP | value);
+            if (applied)
+                display->animation_duty = value;
+        }
+        break;
+    case HT16K33_ANIM_BLINK:
+    {
+        bool on = done || keyframe->period_ms == 0 || (elapsed_ms / keyframe->period_ms) % 2 == 0;
+        if (on != display->animation_on)
+        {
+            applied = HT16K33_queueCommand(display, ALPHA_CMD_DISPLAY_SETUP | (display->blink_rate << 1) | on);
+            if (applied)
+                display->animation_on = on;
+        }
+        break;
+    }
+    case HT16K33_ANIM_DIGIT_LEVEL:
+        HT16K33_setDigitLevel(display, keyframe->digit, value);
+        break;
+    }
+
+    if (!done || !applied)
+        return true;
+
+    display->keyframe_start = get_absolute_time();
+    if (++display->animation_index < display->animation_length)
+        return true;
+
+    if (display->animation_loop)
+    {
+        display->animation_index = 0;
+        return true;
+    }
+
+    display->animating = false;
+    // Wake HT16K33_waitAnimation on either core
+    __sev();
+    return false;
+}
+
+// Queue one command byte to every display, never blocks
+static bool HT16K33_queueCommand(HT16K33 *display, uint8_t command)
+{
+    bool status = true;
+
+    for (uint8_t i = 1; i <= display->number_of_displays; i++)
+    {
+        if (display->display_connected[i - 1] && !HT16K33_queueRAM(display, i, command, NULL, 0))
+            status = false;
+    }
+    return status;
+}
+
+// Blank digits below full level on the refreshes their level does not cover, the accumulator
+// spreads the lit refreshes evenly
+static void HT16K33_ditherDigits(HT16K33 *display, uint8_t *ram)
+{
+    for (uint8_t digit = 0; digit < 4 * display->number_of_displays; digit++)
+    {
+        uint8_t level = display->digit_level[digit];
+        if (level >= HT16K33_DIGIT_LEVELS)
+            continue;
+
+        display->digit_dither[digit] += level;
+        if (display->digit_dither[digit] >= HT16K33_DIGIT_LEVELS)
+        {
+            display->digit_dither[digit] -= HT16K33_DIGIT_LEVELS;
+            continue;
+        }
+
+        const HT16K33_segment_bit *map = segment_map[digit % 4];
+        uint8_t *digit_ram = HT16K33_RAM(ram, digit / 4);
+        for (uint8_t segment = 0; segment < 14; segment++)
+        {
+            digit_ram[map[segment].offset] &= ~map[segment].mask;
+        }
+    }
+}
+
+/*---------------------------- Keyscan functions ---------------------------------*/
+
+// Switch ROW15/INT of every display to an active low INT output and watch it on intGpio.
+// The INT outputs of a chain can share intGpio. Key RAM is only read after INT fired, and
+// once more HT16K33_KEY_REREAD_MS later while keys are down because releases raise no INT.
+bool HT16K33_enableKeyscan(HT16K33 *display, uint intGpio)
+{
+    if (keyscan_display != NULL && keyscan_display != display)
+        return false;
+
+    memset(display->key_state, 0, sizeof(display->key_state));
+    memset(display->key_candidate, 0, sizeof(display->key_candidate));
+    display->key_candidate_reads = 0;
+    display->key_head = 0;
+    display->key_tail = 0;
+    display->key_events_dropped = 0;
+    display->key_int_gpio = intGpio;
+
+    if (!HT16K33_writeCommand(display, ALPHA_CMD_ROWINT_SETUP | 0b01))
+        return false;
+
+    gpio_init(intGpio);
+    gpio_pull_up(intGpio);
+
+    keyscan_display = display;
+    display->keyscan_enabled = true;
+
+    // Read once to clear a flag that was raised before the interrupt was enabled
+    display->key_irq_pending = true;
+    gpio_add_raw_irq_handler(intGpio, HT16K33_keyIrq);
+    gpio_set_irq_enabled(intGpio, GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    return true;
+}
+
+bool HT16K33_disableKeyscan(HT16K33 *display)
+{
+    if (!display->keyscan_enabled)
+        return true;
+
+    gpio_set_irq_enabled(display->key_int_gpio, GPIO_IRQ_EDGE_FALL, false);
+    gpio_remove_raw_irq_handler(display->key_int_gpio, HT16K33_keyIrq);
+    display->keyscan_enabled = false;
+    keyscan_display = NULL;
+
+    return HT16K33_writeCommand(display, ALPHA_CMD_ROWINT_SETUP | 0b00);
+}
+
+static void HT16K33_keyIrq(void)
+{
+    HT16K33 *display = keyscan_display;
+
+    if (display && (gpio_get_irq_event_mask(display->key_int_gpio) & GPIO_IRQ_EDGE_FALL))
+    {
+        gpio_acknowledge_irq(display->key_int_gpio, GPIO_IRQ_EDGE_FALL);
+        display->key_irq_pending = true;
+    }
+}
+
+// Read the key RAM if INT fired or a re-read is due and queue the debounced changes.
+// Call from the application loop, it does not touch the bus otherwise.
+bool HT16K33_serviceKeys(HT16K33 *display)
+{
+    if (!display->keyscan_enabled)
+        return false;
+
+    bool unsettled = display->key_candidate_reads < HT16K33_KEY_DEBOUNCE_READS;
+    for (uint8_t i = 0; i < display->number_of_displays && !unsettled; i++)
+    {
+        for (uint8_t k = 0; k < 3; k++)
+        {
+            if (display->key_candidate[i][k])
+                unsettled = true;
+        }
+    }
+
+    if (!display->key_irq_pending && !(unsettled && time_reached(display->key_next_read)))
+        return true;
+
+    display->key_irq_pending = false;
+    display->key_next_read = make_timeout_time_ms(HT16K33_KEY_REREAD_MS);
+
+    if (!HT16K33_readKeyRAM(display))
+        return false;
+
+    bool changed = false;
+    for (uint8_t i = 0; i < display->number_of_displays; i++)
+    {
+        for (uint8_t k = 0; k < 3; k++)
+        {
+            uint16_t keys = (display->key_ram[i][k * 2] | (display->key_ram[i][k * 2 + 1] << 8)) & 0x1FFF;
+            if (keys != display->key_candidate[i][k])
+                changed = true;
+            display->key_candidate[i][k] = keys;
+        }
+    }
+
+    if (changed)
+    {
+        display->key_candidate_reads = 1;
+        return true;
+    }
+
+    if (display->key_candidate_reads < HT16K33_KEY_DEBOUNCE_READS)
+        display->key_candidate_reads++;
+    if (display->key_candidate_reads < HT16K33_KEY_DEBOUNCE_READS)
+        return true;
+
+    for (uint8_t i = 0; i < display->number_of_displays; i++)
+    {
+        for (uint8_t k = 0; k < 3; k++)
+        {
+            uint16_t diff = display->key_state[i][k] ^ display->key_candidate[i][k];
+            while (diff)
+            {
+                uint8_t row = __builtin_ctz(diff);
+                HT16K33_pushKeyEvent(display, i + 1, k * 13 + row, (display->key_candidate[i][k] >> row) & 1);
+                diff &= diff - 1;
+            }
+            display->key_state[i][k] = display->key_candidate[i][k];
+        }
+    }
+    return true;
+}
+
+bool HT16K33_getKeyEvent(HT16K33 *display, HT16K33_key_event *event)
+{
+    HT16K33_serviceKeys(display);
+
+    if (display->key_tail == display->key_head)
+        return false;
+
+    *event = display->key_events[display->key_tail];
+    display->key_tail = (display->key_tail + 1) % HT16K33_KEY_QUEUE_LEN;
+    return true;
+}
+
+// Reading the key RAM also clears the INT flag. With DMA attached the reads are queued behind
+// running transfers, so this is safe while the frame refresh is running on this core.
+static bool HT16K33_readKeyRAM(HT16K33 *display)
+{
+    bool status = true;
+    uint8_t reg = HT16K33_KEY_RAM;
+
+    if (display->dma == NULL)
+    {
+        for (uint8_t i = 1; i <= display->number_of_displays; i++)
+        {
+            if (!HT16K33_readRAM(display, HT16K33_lookUpDisplayAddress(display, i), reg, display->key_ram[i - 1], 6))
+                status = false;
+        }
+        return status;
+    }
+
+    for (uint8_t i = 1; i <= display->number_of_displays; i++)
+    {
+        // The read itself tells if a disconnected display is back
+        if (!display->display_connected[i - 1])
+        {
+            if (!time_reached(display->next_probe_time[i - 1]))
+            {
+                status = false;
+                continue;
+            }
+            display->display_connected[i - 1] = true;
+        }
+
+        display->key_read_busy[i - 1] = true;
+        display->bus_transactions++;
+        display->bus_bytes += 1 + 6;
+        if (!i2c_dma_write_read(display->dma, HT16K33_lookUpDisplayAddress(display, i), &reg, 1, display->key_ram[i - 1], 6, HT16K33_keyReadDone, &display->dma_context[i - 1]))
+        {
+            display->key_read_busy[i - 1] = false;
+            status = false;
+        }
+    }
+
+    for (uint8_t i = 0; i < display->number_of_displays; i++)
+    {
+        while (display->key_read_busy[i])
+            tight_loop_contents();
+    }
+
+    for (uint8_t i = 1; i <= display->number_of_displays; i++)
+    {
+        if (!display->display_connected[i - 1])
+            status = false;
+    }
+    return status;
+}
+
+static void HT16K33_keyReadDone(bool success, void *user_data)
+{
+    HT16K33_dma_context *context = (HT16K33_dma_context *)user_data;
+    HT16K33 *display = (HT16K33 *)context->display;
+
+    if (!success)
+        HT16K33_markDisconnected(display, context->display_number);
+    display->key_read_busy[context->display_number - 1] = false;
+}
+
+static void HT16K33_pushKeyEvent(HT16K33 *display, uint8_t displayNumber, uint8_t key, bool pressed)
+{
+    uint8_t next = (display->key_head + 1) % HT16K33_KEY_QUEUE_LEN;
+
+    if (next == display->key_tail)
+    {
+        display->key_events_dropped++;
+        return;
+    }
+
+    display->key_events[display->key_head].display_number = displayNumber;
+    display->key_events[display->key_head].key = key;
+    display->key_events[display->key_head].pressed = pressed;
+    display->key_events[display->key_head].time_ms = to_ms_since_boot(get_absolute_time());
+    display->key_head = next;
+}
@@ -1,9 +1,11 @@
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "hardware/adc.h"
 #include "SparkFun_Alphanumeric_Display.h"
+#include "i2c_dma.h"
 
 #define I2C_PORT i2c1
 #define MY_I2C_SDA_PIN 14
@@ -11,6 +13,10 @@
 
 #define TEST_SAMPLES 100000
 #define NUM_SAMPLES 1000
+#define TEST_PRINTS 100
+#define TEST_GLYPH_PRINTS 1000
+#define TEST_RENDERS 100
+#define TEST_SCROLL_MS 3000
 
 uint32_t adc0_sum = 0;
 uint32_t adc1_sum = 0;
@@ -24,6 +30,7 @@ unsigned int counter = 0;
 char tempString[10];
 
 HT16K33 display;
+i2c_dma_t display_dma;
 
 void setup_i2c();
 void setup_adc();
@@ -31,6 +38,12 @@ void serial_display_setup();
 void serial_display_loop();
 void run_serial_display();
 void test_max_poll_rate();
+void test_print_rate();
+void test_glyph_rate();
+void test_render_rate();
+void test_begin_rate();
+void test_scroll_cpu();
+uint32_t count_idle_loops(uint32_t ms);
 
 int main()
 {
@@ -45,6 +58,11 @@ int main()
     printf("I2C and ADC initialized\n");
 
     test_max_poll_rate();
+    test_print_rate();
+    test_glyph_rate();
+    test_render_rate();
+    test_begin_rate();
+    test_scroll_cpu();
     run_serial_display();
 
     return 0;
@@ -153,4 +171,216 @@ void test_max_poll_rate()
     float poll_rate = TEST_SAMPLES / elapsed_time_s;
     printf("Max poll rate: %.2f samples per second\n", poll_rate);
     printf("Elapsed time for %d samples: %.2f seconds\n", TEST_SAMPLES, elapsed_time_s);
-}
\ No newline at end of file
+}
+
+void test_print_rate()
+{
+    char text[5] = "TES0";
+
+    printf("test_print_rate\n");
+    uint32_t start_transactions = display.bus_transactions;
+    uint32_t start_bytes = display.bus_bytes;
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_PRINTS; count++)
+    {
+        HT16K33_print(&display, "TEST");
+    }
+    uint64_t end = time_us_64();
+    uint32_t transactions = display.bus_transactions - start_transactions;
+    printf("Bus transactions per print: %.2f\n", (float)transactions / TEST_PRINTS);
+    printf("Bus bytes per print: %.2f\n", (float)(display.bus_bytes - start_bytes) / TEST_PRINTS);
+    printf("Average time per print: %.2f us\n", (float)(end - start) / TEST_PRINTS);
+
+    // Only the last digit changes
+    start_transactions = display.bus_transactions;
+    start_bytes = display.bus_bytes;
+    start = time_us_64();
+    for (int count = 0; count < TEST_PRINTS; count++)
+    {
+        text[3] = '0' + count % 10;
+        HT16K33_print(&display, text);
+    }
+    end = time_us_64();
+    printf("Bus transactions per one digit print: %.2f\n", (float)(display.bus_transactions - start_transactions) / TEST_PRINTS);
+    printf("Bus bytes per one digit print: %.2f\n", (float)(display.bus_bytes - start_bytes) / TEST_PRINTS);
+    printf("Average time per one digit print: %.2f us\n", (float)(end - start) / TEST_PRINTS);
+}
+
+// Print throughput with 0, 10 and all 94 printable characters redefined. The glyphs are redefined
+// to their default segments, the display content is unchanged so no RAM is written after the first print.
+void test_glyph_rate()
+{
+    const uint8_t glyph_counts[] = {0, 10, 94};
+    uint8_t defined = 0;
+
+    printf("test_glyph_rate\n");
+    for (uint32_t i = 0; i < count_of(glyph_counts); i++)
+    {
+        for (; defined < glyph_counts[i]; defined++)
+        {
+            HT16K33_defineChar(&display, '!' + defined, HT16K33_getSegmentsToTurnOn(&display, defined + 1));
+        }
+
+        HT16K33_print(&display, "~}|{");
+        uint64_t start = time_us_64();
+        for (int count = 0; count < TEST_GLYPH_PRINTS; count++)
+        {
+            HT16K33_print(&display, "~}|{");
+        }
+        uint64_t end = time_us_64();
+        printf("%d custom glyphs: %.0f prints per second\n", glyph_counts[i], TEST_GLYPH_PRINTS * 1000000.0f / (end - start));
+    }
+}
+
+// Segment to RAM bit arithmetic of HT16K33_illuminateSegment before the segment_map table, kept as
+// the reference for test_render_rate
+static void reference_illuminateSegment(uint8_t *ram, uint8_t segment, uint8_t digit)
+{
+    uint8_t com = segment - 'A';
+
+    if (com > 6)
+        com -= 7;
+    if (segment == 'I')
+        com = 0;
+    if (segment == 'H')
+        com = 1;
+
+    uint8_t row = digit % 4;
+    if (segment > 'G')
+        row += 4;
+
+    uint8_t adr = com * 2;
+
+    if (row > 7)
+        adr++;
+
+    if (row > 7)
+        row -= 8;
+    uint8_t dat = 1 << row;
+
+    HT16K33_RAM(ram, digit / 4)[adr] |= dat;
+}
+
+static void reference_illuminateChar(uint8_t *ram, uint16_t segmentsToTurnOn, uint8_t digit)
+{
+    for (uint8_t i = 0; i < 14; i++)
+    {
+        if ((segmentsToTurnOn >> i) & 0b1)
+            reference_illuminateSegment(ram, 'A' + i, digit);
+    }
+}
+
+// Cost of rendering a character into display_ram with the segment_map table and with the reference
+// arithmetic, both must give the same RAM image. Nothing is written to the display.
+void test_render_rate()
+{
+    uint16_t segments[96];
+    uint8_t table_ram[HT16K33_RAM_BLOCK * 4];
+
+    printf("test_render_rate\n");
+    for (int i = 0; i < 96; i++)
+    {
+        segments[i] = HT16K33_getSegmentsToTurnOn(&display, i);
+    }
+
+    // Every character on every digit of a chain of 4 displays
+    for (int i = 0; i < 96; i++)
+    {
+        memset(display.display_ram, 0, sizeof(display.display_ram));
+        memset(table_ram, 0, sizeof(table_ram));
+        for (uint8_t digit = 0; digit < 16; digit++)
+        {
+            HT16K33_illuminateChar(&display, segments[i], digit);
+            reference_illuminateChar(table_ram, segments[i], digit);
+        }
+        if (memcmp(display.display_ram, table_ram, sizeof(table_ram)) != 0)
+            printf("Character %d renders differently from the reference\n", i);
+    }
+
+    uint64_t start = time_us_64();
+    for (int count = 0; count < TEST_RENDERS; count++)
+    {
+        for (int i = 0; i < 96; i++)
+        {
+            HT16K33_illuminateChar(&display, segments[i], i % 4);
+        }
+    }
+    uint64_t end = time_us_64();
+    printf("Average time per character, segment table: %.3f us\n", (float)(end - start) / (TEST_RENDERS * 96));
+
+    start = time_us_64();
+    for (int count = 0; count < TEST_RENDERS; count++)
+    {
+        for (int i = 0; i < 96; i++)
+        {
+            reference_illuminateChar(display.display_ram, segments[i], i % 4);
+        }
+    }
+    end = time_us_64();
+    printf("Average time per character, reference arithmetic: %.3f us\n", (float)(end - start) / (TEST_RENDERS * 96));
+
+    HT16K33_clear(&display);
+}
+
+// Time of HT16K33_begin, including HT16K33_initialize, for chains of 1 to 4 displays at 0x70 to 0x73.
+// Displays that are not attached make begin fail after its retries.
+void test_begin_rate()
+{
+    uint8_t addresses[4];
+
+    printf("test_begin_rate\n");
+    for (uint8_t count = 1; count <= 4; count++)
+    {
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            addresses[i] = i < count ? DEFAULT_ADDRESS + i : DEFAULT_NOTHING_ATTACHED;
+        }
+
+        uint64_t start = time_us_64();
+        bool status = HT16K33_begin(&display, addresses[0], addresses[1], addresses[2], addresses[3], I2C_PORT);
+        uint64_t end = time_us_64();
+        printf("%d displays: %s in %.2f ms\n", count, status ? "initialized" : "failed", (end - start) / 1000.0f);
+    }
+
+    // Back to the single display used by the serial display
+    HT16K33_begin(&display, 0x70, DEFAULT_NOTHING_ATTACHED, DEFAULT_NOTHING_ATTACHED, DEFAULT_NOTHING_ATTACHED, I2C_PORT);
+}
+
+uint32_t count_idle_loops(uint32_t ms)
+{
+    uint32_t loops = 0;
+    absolute_time_t end = make_timeout_time_ms(ms);
+    while (!time_reached(end))
+        loops++;
+    return loops;
+}
+
+// Share of this core taken by a running marquee, measured as lost iterations of an idle loop
+void test_scroll_cpu()
+{
+    printf("test_scroll_cpu\n");
+    if (!i2c_dma_init(&display_dma, I2C_PORT))
+    {
+        printf("No free DMA channels for the display\n");
+        return;
+    }
+    HT16K33_attachDMA(&display, &display_dma);
+
+    uint32_t idle_loops = count_idle_loops(TEST_SCROLL_MS);
+
+    if (!HT16K33_startRefresh(&display, 50) ||
+        !HT16K33_startScroll(&display, "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789", 100))
+    {
+        printf("Scroll not started\n");
+        HT16K33_stopRefresh(&display);
+        return;
+    }
+    uint32_t start_bytes = display.bus_bytes;
+    uint32_t scroll_loops = count_idle_loops(TEST_SCROLL_MS);
+    uint32_t bytes = display.bus_bytes - start_bytes;
+    HT16K33_stopRefresh(&display);
+
+    printf("CPU used by scrolling: %.2f%%\n", 100.0f * (idle_loops - scroll_loops) / idle_loops);
+    printf("Bus bytes per second: %.0f, frames dropped: %lu\n", bytes * 1000.0f / TEST_SCROLL_MS, display.frames_dropped);
+    HT16K33_clear(&display);
+}
@@ -0,0 +1,222 @@
+#include "i2c_dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+// The controller is fed with IC_DATA_CMD words by the TX channel, read data is drained by the RX channel.
+// Completion is signalled by the STOP_DET interrupt, a NAK by TX_ABRT.
+
+static i2c_dma_t *i2c_dma_buses[2];
+
+static void startTransfer(i2c_dma_t *bus);
+static void waitForAbortStop(i2c_hw_t *hw);
+static void handleIrq(i2c_dma_t *bus);
+// The controller still sends a STOP after TX_ABRT. If the next transfer were started before that,
+// the late STOP_DET would complete the next transfer before any of its bytes went out.
+static void waitForAbortStop(i2c_hw_t *hw)
+{
+    absolute_time_t deadline = make_timeout_time_us(I2C_DMA_ABORT_TIMEOUT_US);
+
+    while (!(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS) && (hw->status & I2C_IC_STATUS_ACTIVITY_BITS))
+    {
+        if (time_reached(deadline))
+            break;
+        tight_loop_contents();
+    }
+}
+
+static void i2c0IrqHandler(void);
+static void i2c1IrqHandler(void);
+static bool queueTransfer(i2c_dma_t *bus, uint8_t address, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, i2c_dma_callback_t callback, void *user_data);
+
+// Claim two DMA channels and install the I2C IRQ handler on the calling core, the bus must only be
+// used from this core. i2c_init must have been called already.
+bool i2c_dma_init(i2c_dma_t *bus, i2c_inst_t *i2c)
+{
+    uint index = i2c_hw_index(i2c);
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+
+    int tx_chan = dma_claim_unused_channel(false);
+    int rx_chan = dma_claim_unused_channel(false);
+    if (tx_chan < 0 || rx_chan < 0)
+    {
+        if (tx_chan >= 0)
+            dma_channel_unclaim(tx_chan);
+        if (rx_chan >= 0)
+            dma_channel_unclaim(rx_chan);
+        return false;
+    }
+
+    bus->i2c = i2c;
+    bus->tx_chan = tx_chan;
+    bus->rx_chan = rx_chan;
+    bus->head = 0;
+    bus->tail = 0;
+    bus->active = false;
+    bus->transfers = 0;
+    bus->errors = 0;
+
+    bus->tx_config = dma_channel_get_default_config(tx_chan);
+    channel_config_set_transfer_data_size(&bus->tx_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&bus->tx_config, true);
+    channel_config_set_write_increment(&bus->tx_config, false);
+    channel_config_set_dreq(&bus->tx_config, i2c_get_dreq(i2c, true));
+
+    bus->rx_config = dma_channel_get_default_config(rx_chan);
+    channel_config_set_transfer_data_size(&bus->rx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&bus->rx_config, false);
+    channel_config_set_write_increment(&bus->rx_config, true);
+    channel_config_set_dreq(&bus->rx_config, i2c_get_dreq(i2c, false));
+
+    hw->intr_mask = 0;
+    hw->dma_tdlr = 4;
+    hw->dma_rdlr = 0;
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+    i2c_dma_buses[index] = bus;
+    irq_set_exclusive_handler(I2C0_IRQ + index, index == 0 ? i2c0IrqHandler : i2c1IrqHandler);
+    irq_set_enabled(I2C0_IRQ + index, true);
+
+    return true;
+}
+
+// Queue a write, the data is copied so src can be reused as soon as this returns
+bool i2c_dma_write(i2c_dma_t *bus, uint8_t address, const uint8_t *src, size_t len, i2c_dma_callback_t callback, void *user_data)
+{
+    return queueTransfer(bus, address, src, len, NULL, 0, callback, user_data);
+}
+
+// Queue a write followed by a repeated start and a read into dst, dst must stay valid until the callback
+bool i2c_dma_write_read(i2c_dma_t *bus, uint8_t address, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, i2c_dma_callback_t callback, void *user_data)
+{
+    return queueTransfer(bus, address, src, src_len, dst, dst_len, callback, user_data);
+}
+
+bool i2c_dma_busy(i2c_dma_t *bus)
+{
+    return bus->active;
+}
+
+// Blocking transfers on the same controller must wait for the queue to drain first
+void i2c_dma_wait_idle(i2c_dma_t *bus)
+{
+    while (bus->active)
+        tight_loop_contents();
+}
+
+static bool queueTransfer(i2c_dma_t *bus, uint8_t address, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, i2c_dma_callback_t callback, void *user_data)
+{
+    if (src_len + dst_len == 0 || src_len + dst_len > I2C_DMA_MAX_TRANSFER)
+        return false;
+
+    uint32_t interrupts = save_and_disable_interrupts();
+
+    uint8_t next = (bus->head + 1) % I2C_DMA_QUEUE_LEN;
+    if (next == bus->tail)
+    {
+        restore_interrupts(interrupts);
+        return false;
+    }
+
+    i2c_dma_transfer_t *transfer = &bus->queue[bus->head];
+    uint8_t count = 0;
+
+    for (size_t i = 0; i < src_len; i++)
+        transfer->cmds[count++] = src[i];
+    for (size_t i = 0; i < dst_len; i++)
+    {
+        transfer->cmds[count] = I2C_IC_DATA_CMD_CMD_BITS;
+        if (i == 0 && src_len > 0)
+            transfer->cmds[count] |= I2C_IC_DATA_CMD_RESTART_BITS;
+        count++;
+    }
+    transfer->cmds[count - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    transfer->address = address;
+    transfer->cmd_count = count;
+    transfer->dst = dst;
+    transfer->dst_len = dst_len;
+    transfer->callback = callback;
+    transfer->user_data = user_data;
+    bus->head = next;
+
+    if (!bus->active)
+    {
+        bus->active = true;
+        startTransfer(bus);
+    }
+
+    restore_interrupts(interrupts);
+    return true;
+}
+
+static void startTransfer(i2c_dma_t *bus)
+{
+    i2c_dma_transfer_t *transfer = &bus->queue[bus->tail];
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+
+    hw->enable = 0;
+    hw->tar = transfer->address;
+    hw->enable = 1;
+    (void)hw->clr_intr;
+
+    if (transfer->dst_len)
+        dma_channel_configure(bus->rx_chan, &bus->rx_config, transfer->dst, &hw->data_cmd, transfer->dst_len, true);
+    dma_channel_configure(bus->tx_chan, &bus->tx_config, &hw->data_cmd, transfer->cmds, transfer->cmd_count, true);
+
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+}
+
+static void handleIrq(i2c_dma_t *bus)
+{
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    uint32_t status = hw->intr_stat;
+
+    if (!(status & (I2C_IC_INTR_STAT_R_STOP_DET_BITS | I2C_IC_INTR_STAT_R_TX_ABRT_BITS)))
+        return;
+
+    i2c_dma_transfer_t *transfer = &bus->queue[bus->tail];
+    bool success = !(status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS);
+
+    if (success)
+    {
+        // The last received byte can still be on its way to memory
+        while (transfer->dst_len && dma_channel_is_busy(bus->rx_chan))
+            tight_loop_contents();
+    }
+    else
+    {
+        dma_channel_abort(bus->tx_chan);
+        dma_channel_abort(bus->rx_chan);
+        waitForAbortStop(hw);
+        bus->errors++;
+    }
+
+    hw->intr_mask = 0;
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+    (void)hw->clr_intr;
+    bus->transfers++;
+
+    // The slot is released before the callback so the callback can queue the next transfer
+    i2c_dma_callback_t callback = transfer->callback;
+    void *user_data = transfer->user_data;
+
+    bus->tail = (bus->tail + 1) % I2C_DMA_QUEUE_LEN;
+    if (bus->tail != bus->head)
+        startTransfer(bus);
+    else
+        bus->active = false;
+
+    if (callback)
+        callback(success, user_data);
+}
+
+static void i2c0IrqHandler(void)
+{
+    handleIrq(i2c_dma_buses[0]);
+}
+
+static void i2c1IrqHandler(void)
+{
+    handleIrq(i2c_dma_buses[1]);
+}
@@ -0,0 +1,47 @@
+#ifndef I2C_DMA_H
+#define I2C_DMA_H
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+
+#define I2C_DMA_MAX_TRANSFER 40 // Maximum number of bytes written plus bytes read in one transfer
+#define I2C_DMA_QUEUE_LEN 8
+#define I2C_DMA_ABORT_TIMEOUT_US 1000 // Longest wait for the STOP after an aborted transfer
+
+// Called from the I2C IRQ once a queued transfer has finished, success is false if the transfer was aborted (NAK)
+typedef void (*i2c_dma_callback_t)(bool success, void *user_data);
+
+typedef struct
+{
+    uint8_t address;
+    uint8_t cmd_count;
+    uint32_t cmds[I2C_DMA_MAX_TRANSFER];
+    uint8_t *dst;
+    uint8_t dst_len;
+    i2c_dma_callback_t callback;
+    void *user_data;
+} i2c_dma_transfer_t;
+
+typedef struct
+{
+    i2c_inst_t *i2c;
+    uint tx_chan;
+    uint rx_chan;
+    dma_channel_config tx_config;
+    dma_channel_config rx_config;
+    i2c_dma_transfer_t queue[I2C_DMA_QUEUE_LEN];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    volatile bool active;
+    uint32_t transfers;
+    uint32_t errors;
+} i2c_dma_t;
+
+bool i2c_dma_init(i2c_dma_t *bus, i2c_inst_t *i2c);
+bool i2c_dma_write(i2c_dma_t *bus, uint8_t address, const uint8_t *src, size_t len, i2c_dma_callback_t callback, void *user_data);
+bool i2c_dma_write_read(i2c_dma_t *bus, uint8_t address, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, i2c_dma_callback_t callback, void *user_data);
+bool i2c_dma_busy(i2c_dma_t *bus);
+void i2c_dma_wait_idle(i2c_dma_t *bus);
+
+#endif // I2C_DMA_H